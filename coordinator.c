@@ -0,0 +1,459 @@
+// Work unit coordinator of euler.c and euler413.c, compile with gcc -O2 -o coordinator coordinator.c
+//
+// coordinator [-listen address] [-timeout seconds]
+// address is host:port for TCP ( default 127.0.0.1:5413, 0.0.0.0:port serves the other hosts ) or the path of a local socket.
+// The workers lease the units one by one ( the residues of euler.c or the a0 classes of euler413.c ), see coordinator.h
+// for the protocol. A lease without a heartbeat for timeout seconds is given to the next worker, so a crashed or stalled
+// worker doesn't lose its unit, and a fast worker gets a new unit when it finishes, so there are no idle tails.
+// The finished units are saved in coordinator_work.txt, so the coordinator can be restarted. The finished, failed and
+// timed out units are logged in coordinator_log.txt and the solutions reported by the workers are in coordinator_solutions.txt.
+// STATUS shows the state: coordinator -status [-listen address]
+//
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <ctype.h>
+#include <time.h>
+#include <errno.h>
+#include <unistd.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <sys/time.h>
+#include <netdb.h>
+#include "coordinator.h"
+
+typedef struct  {
+   unsigned long int unit,lease;
+   time_t start,seen;  // the time of the lease and of its last heartbeat
+   char worker[64];
+} lease_info;
+
+   char search[COORDINATOR_LINE];  // the search of the workers, empty until the first LEASE
+   unsigned long int first_unit,last_unit;
+   unsigned char *finished=NULL;  // bitmap of the finished units, bit u-first_unit
+   unsigned long int num_finished=0,lowest_unfinished;
+   lease_info *leases=NULL;  // the active leases
+   unsigned long int num_leases=0,size_leases=0;
+   unsigned long int next_lease=1,timeout=COORDINATOR_TIMEOUT;
+   unsigned long int num_failed=0,num_expired=0;
+   double total_seconds=0.0;  // the time of the units finished since the start of the coordinator
+   unsigned long int num_timed=0;
+   unsigned long int *solutions=NULL;  // the hashes of the lines of coordinator_solutions.txt
+   unsigned long int num_solutions=0,size_solutions=0;
+
+unsigned long int is_finished(unsigned long int u)
+{
+   return (finished[(u-first_unit)>>3]>>((u-first_unit)&7))&1;
+}
+
+void log_line(char *line)
+{
+   FILE* out;
+   time_t date;
+
+   time(&date);
+   out=fopen("coordinator_log.txt","a+");
+   if(out==NULL)  return;
+   fprintf(out,"%s,Date: %s",line,ctime(&date));
+   fclose(out);
+   printf("%s\n",line);
+
+   return;
+}
+
+void append_solution_hash(unsigned long int h)
+{
+   if(num_solutions==size_solutions)  {
+      size_solutions*=2;
+      solutions=(unsigned long int*) (realloc) (solutions,size_solutions*sizeof(unsigned long int));
+   }
+   solutions[num_solutions++]=h;
+
+   return;
+}
+
+unsigned long int solution_hash(char *text)
+{
+// FNV-1a hash of a solution line
+   unsigned long int h=14695981039346656037UL;
+
+   for(;*text;text++)  h=(h^(unsigned char) *text)*1099511628211UL;
+
+   return h;
+}
+
+unsigned long int append_solution(char *text)
+{
+// appends the solution to coordinator_solutions.txt if it isn't there yet, a worker that lost its lease or
+// an other worker of the same unit reports it again. The hashes of the lines of the file are read at the
+// first solution and kept in solutions[]. Returns 1 if it is a new solution.
+   FILE* out;
+   char line[COORDINATOR_LINE+2];
+   unsigned long int h,j;
+
+   if(solutions==NULL)  {
+      size_solutions=1024;
+      solutions=(unsigned long int*) (malloc) (size_solutions*sizeof(unsigned long int));
+      out=fopen("coordinator_solutions.txt","r");
+      if(out!=NULL)  {
+         while(fgets(line,COORDINATOR_LINE+2,out)!=NULL)  {
+            line[strcspn(line,"\n")]=0;
+            append_solution_hash(solution_hash(line));
+         }
+         fclose(out);
+      }
+   }
+   h=solution_hash(text);
+   for(j=0;j<num_solutions;j++)
+       if(solutions[j]==h)  return 0;
+   append_solution_hash(h);
+   out=fopen("coordinator_solutions.txt","a+");
+   if(out!=NULL)  {
+      fprintf(out,"%s\n",text);
+      fclose(out);
+   }
+
+   return 1;
+}
+
+void save_work(void)
+{
+// written to a temporary file and renamed, as the workfiles of the searchers,
+// done= is the bitmap of the finished units from first_unit, a hex digit for 4 units
+   FILE* workfile;
+   unsigned long int j,u;
+
+   workfile=fopen("coordinator_work.tmp","w");
+   if(workfile==NULL)  {
+      printf("Cannot write the workfile!\n");
+      return;
+   }
+   fprintf(workfile,"// Please don't modify this file\n");
+   fprintf(workfile,"search=%s\n",search);
+   fprintf(workfile,"first=%ld\n",first_unit);
+   fprintf(workfile,"last=%ld\n",last_unit);
+   fprintf(workfile,"done=");
+   for(u=first_unit;u<=last_unit;u+=4)  {
+       j=finished[(u-first_unit)>>3];
+       if((u-first_unit)&4)  j>>=4;
+       fprintf(workfile,"%lx",j&15);
+   }
+   fprintf(workfile,"\n");
+   fflush(workfile);
+   fsync(fileno(workfile));
+   fclose(workfile);
+   rename("coordinator_work.tmp","coordinator_work.txt");
+
+   return;
+}
+
+void read_work(void)
+{
+   FILE* workfile;
+   char *line;
+   unsigned long int j,u,v;
+
+   workfile=fopen("coordinator_work.txt","r");
+   if(workfile==NULL)  return;
+   line=(char*) (malloc) (COORDINATOR_LINE+1048576);
+   while(fgets(line,COORDINATOR_LINE+1048576,workfile)!=NULL)  {
+      line[strcspn(line,"\n")]=0;
+      if(!memcmp(line,"search=",7))  strcpy(search,line+7);
+      if(!memcmp(line,"first=",6))   first_unit=strtoul(line+6,NULL,10);
+      if(!memcmp(line,"last=",5))    last_unit=strtoul(line+5,NULL,10);
+      if(!memcmp(line,"done=",5))  {
+         finished=(unsigned char*) (calloc) ((last_unit-first_unit)/8+1,sizeof(unsigned char));
+         for(j=0;isxdigit(line[5+j])&&(first_unit+4*j<=last_unit);j++)  {
+             v=(line[5+j]<='9')?line[5+j]-'0':(line[5+j]|32)-'a'+10;
+             for(u=0;u<4;u++)
+                 if(((v>>u)&1)&&(first_unit+4*j+u<=last_unit))  {
+                    finished[(4*j+u)>>3]|=1<<((4*j+u)&7);
+                    num_finished++;
+                 }
+         }
+      }
+   }
+   fclose(workfile);
+   free(line);
+   if((finished==NULL)||(search[0]==0))  {
+      printf("The workfile coordinator_work.txt is corrupt, remove it to start a new search.\n");
+      exit(1);
+   }
+   lowest_unfinished=first_unit;
+   while((lowest_unfinished<=last_unit)&&is_finished(lowest_unfinished))  lowest_unfinished++;
+   printf("Continue the search %s: %ld of the units %ld..%ld are finished\n",search,num_finished,first_unit,last_unit);
+
+   return;
+}
+
+void remove_lease(unsigned long int j)
+{
+   leases[j]=leases[--num_leases];
+
+   return;
+}
+
+long int find_lease(unsigned long int unit)
+{
+   unsigned long int j;
+
+   for(j=0;j<num_leases;j++)
+       if(leases[j].unit==unit)  return j;
+
+   return -1;
+}
+
+void expire_leases(void)
+{
+// a lease without a heartbeat for timeout seconds is dropped, its unit is given to the next worker
+   char line[COORDINATOR_LINE+256];
+   unsigned long int j;
+   time_t now=time(NULL);
+
+   for(j=0;j<num_leases;)  {
+       if((unsigned long int) (now-leases[j].seen)>timeout)  {
+          sprintf(line,"Expired: unit=%ld,lease=%ld,worker=%s",leases[j].unit,leases[j].lease,leases[j].worker);
+          log_line(line);
+          num_expired++;
+          remove_lease(j);
+       }
+       else  j++;
+   }
+
+   return;
+}
+
+void lease_unit(char *request, char *reply)
+{
+   char name[COORDINATOR_LINE],worker[COORDINATOR_LINE];
+   unsigned long int first,last,u,wait;
+   time_t now=time(NULL);
+
+   if(sscanf(request,"LEASE %s %lu %lu %s",name,&first,&last,worker)!=4)  {
+      sprintf(reply,"ERROR bad request");
+      return;
+   }
+   if(search[0]==0)  {
+      // the first worker gives the search
+      if(first>last)  {
+         sprintf(reply,"ERROR bad units");
+         return;
+      }
+      strcpy(search,name);
+      first_unit=first,last_unit=last,lowest_unfinished=first;
+      finished=(unsigned char*) (calloc) ((last_unit-first_unit)/8+1,sizeof(unsigned char));
+      printf("Search %s, units %ld..%ld\n",search,first_unit,last_unit);
+      save_work();
+   }
+   if(strcmp(name,search)||(first!=first_unit)||(last!=last_unit))  {
+      sprintf(reply,"ERROR this coordinator serves %s %ld %ld",search,first_unit,last_unit);
+      return;
+   }
+   if(num_finished==last_unit-first_unit+1)  {
+      sprintf(reply,"DONE");
+      return;
+   }
+   for(u=lowest_unfinished;u<=last_unit;u++)
+       if((!is_finished(u))&&(find_lease(u)<0))  break;
+   if(u>last_unit)  {
+      // all unfinished units are leased, ask again when the first lease can time out
+      wait=timeout;
+      for(u=0;u<num_leases;u++)
+          if((unsigned long int) (leases[u].seen+timeout-now)<wait)  wait=leases[u].seen+timeout-now;
+      if(wait>timeout/4)  wait=timeout/4;
+      sprintf(reply,"WAIT %ld",wait+1);
+      return;
+   }
+   if(num_leases==size_leases)  {
+      size_leases=2*size_leases+16;
+      leases=(lease_info*) (realloc) (leases,size_leases*sizeof(lease_info));
+   }
+   leases[num_leases].unit=u;
+   leases[num_leases].lease=next_lease++;
+   leases[num_leases].start=now;
+   leases[num_leases].seen=now;
+   strncpy(leases[num_leases].worker,worker,63);
+   leases[num_leases].worker[63]=0;
+   sprintf(reply,"UNIT %ld %ld %ld",u,leases[num_leases].lease,(timeout>=4)?timeout/4:1);
+   printf("Leased: unit=%ld,lease=%ld,worker=%s\n",u,leases[num_leases].lease,leases[num_leases].worker);
+   num_leases++;
+
+   return;
+}
+
+void finish_unit(char *request, char *reply)
+{
+// the result is taken also from a timed out lease, the unit is searched
+   char line[COORDINATOR_LINE+256];
+   unsigned long int u,lease,seconds,solutions;
+   long int j;
+
+   if((sscanf(request,"RESULT %lu %lu %lu %lu",&u,&lease,&seconds,&solutions)!=4)||(search[0]==0)||(u<first_unit)||(u>last_unit))  {
+      sprintf(reply,"ERROR bad request");
+      return;
+   }
+   j=find_lease(u);
+   sprintf(line,"Finished: unit=%ld,lease=%ld,worker=%s,Time: %lds,solutions=%ld",u,lease,
+           ((j>=0)&&(leases[j].lease==lease))?leases[j].worker:"-",seconds,solutions);
+   if(is_finished(u))  strcat(line,",already finished");
+   log_line(line);
+   if(!is_finished(u))  {
+      finished[(u-first_unit)>>3]|=1<<((u-first_unit)&7);
+      num_finished++;
+      total_seconds+=seconds,num_timed++;
+      while((lowest_unfinished<=last_unit)&&is_finished(lowest_unfinished))  lowest_unfinished++;
+      save_work();
+      if(num_finished==last_unit-first_unit+1)  log_line("All units are finished");
+   }
+   if(j>=0)  remove_lease(j);
+   sprintf(reply,"OK");
+
+   return;
+}
+
+void status(char *reply)
+{
+   char *s=reply;
+   unsigned long int j,k,units,workers;
+   double mean;
+   time_t now=time(NULL);
+
+   if(search[0]==0)  {
+      sprintf(reply,"No search yet, waiting for the first worker\n");
+      return;
+   }
+   units=last_unit-first_unit+1;
+   // the workers with a lease
+   workers=0;
+   for(j=0;j<num_leases;j++)  {
+       for(k=0;(k<j)&&strcmp(leases[k].worker,leases[j].worker);k++);
+       if(k==j)  workers++;
+   }
+   s+=sprintf(s,"Search %s, units %ld..%ld\n",search,first_unit,last_unit);
+   s+=sprintf(s,"finished: %ld, leased: %ld, waiting: %ld, failed: %ld, timed out: %ld\n",num_finished,num_leases,
+              units-num_finished-num_leases,num_failed,num_expired);
+   if(num_timed>0)  {
+      mean=total_seconds/num_timed;
+      s+=sprintf(s,"mean time of a unit: %.0f sec",mean);
+      if(workers>0)  s+=sprintf(s,", about %.1f hours are left with %ld workers",mean*(units-num_finished)/workers/3600.0,workers);
+      s+=sprintf(s,"\n");
+   }
+   for(j=0;(j<num_leases)&&(j<64);j++)
+       s+=sprintf(s,"unit=%ld,lease=%ld,worker=%s,running for %ld sec, last heartbeat %ld sec ago\n",leases[j].unit,leases[j].lease,
+                  leases[j].worker,(long int) (now-leases[j].start),(long int) (now-leases[j].seen));
+
+   return;
+}
+
+void handle_request(char *request, char *reply)
+{
+   char line[COORDINATOR_LINE+256];
+   unsigned long int u,lease;
+   long int j;
+   int n;
+
+   expire_leases();
+   if(!memcmp(request,"LEASE ",6))  lease_unit(request,reply);
+   else if(!memcmp(request,"RESULT ",7))  finish_unit(request,reply);
+   else if(!strcmp(request,"STATUS"))  status(reply);
+   else if(sscanf(request,"HEARTBEAT %lu %lu",&u,&lease)==2)  {
+      j=find_lease(u);
+      if((j>=0)&&(leases[j].lease==lease))  leases[j].seen=time(NULL),sprintf(reply,"OK");
+      else  sprintf(reply,"LOST");
+   }
+   else if(sscanf(request,"FAIL %lu %lu %n",&u,&lease,&n)==2)  {
+      j=find_lease(u);
+      if((j>=0)&&(leases[j].lease==lease))  {
+         sprintf(line,"Failed: unit=%ld,lease=%ld,worker=%s,%.256s",u,lease,leases[j].worker,request+n);
+         log_line(line);
+         num_failed++;
+         remove_lease(j);
+      }
+      sprintf(reply,"OK");
+   }
+   else if(sscanf(request,"SOLUTION %lu %lu %n",&u,&lease,&n)==2)  {
+      if(append_solution(request+n))  {
+         sprintf(line,"Solution: unit=%ld,%.512s",u,request+n);
+         log_line(line);
+      }
+      sprintf(reply,"OK");
+   }
+   else  sprintf(reply,"ERROR unknown request");
+
+   return;
+}
+
+int main (int argc, char *argv[])  {
+
+   char *address=COORDINATOR_ADDRESS;
+   char request[COORDINATOR_LINE+1],*reply;
+   unsigned long int j,show;
+   long int n,len;
+   int fd,server;
+   struct timeval wait;
+
+   show=0;
+   for(j=1;j<argc;j++)  {
+       if((!strcmp(argv[j],"-listen"))&&(j+1<argc))  address=argv[++j];
+       else if((!strcmp(argv[j],"-timeout"))&&(j+1<argc))  timeout=strtoul(argv[++j],NULL,10);
+       else if(!strcmp(argv[j],"-status"))  show=1;
+       else  {
+          printf("Unknown parameter: %s\n",argv[j]);
+          return 1;
+       }
+   }
+   if(timeout==0)  timeout=1;
+   reply=(char*) (malloc) (65536);
+
+   if(show)  {
+      fd=coordinator_socket(address,0);
+      if(fd<0)  {
+         printf("Cannot reach the coordinator at %s\n",address);
+         return 1;
+      }
+      send(fd,"STATUS\n",7,MSG_NOSIGNAL);
+      while((n=recv(fd,reply,65535,0))>0)  fwrite(reply,1,n,stdout);
+      close(fd);
+      return 0;
+   }
+
+   read_work();
+   server=coordinator_socket(address,1);
+   if(server<0)  {
+      printf("Cannot listen at %s\n",address);
+      return 1;
+   }
+   printf("The coordinator listens at %s, the lease timeout is %ld sec\n",address,timeout);
+   fflush(stdout);
+
+   // one request on each connection, so a slow or dead worker blocks the others for at most a few seconds
+   wait.tv_sec=5,wait.tv_usec=0;
+   for(;;)  {
+       fd=accept(server,NULL,NULL);
+       if(fd<0)  {
+          if(errno!=EINTR)  perror("accept");
+          continue;
+       }
+       setsockopt(fd,SOL_SOCKET,SO_RCVTIMEO,&wait,sizeof(wait));
+       setsockopt(fd,SOL_SOCKET,SO_SNDTIMEO,&wait,sizeof(wait));
+       len=0;
+       while((len<COORDINATOR_LINE)&&((n=recv(fd,request+len,COORDINATOR_LINE-len,0))>0))  {
+          len+=n;
+          if(memchr(request,'\n',len)!=NULL)  break;
+       }
+       request[len]=0;
+       if(memchr(request,'\n',len)==NULL)  {
+          close(fd);
+          continue;
+       }
+       request[strcspn(request,"\r\n")]=0;
+       handle_request(request,reply);
+       if(reply[strlen(reply)-1]!='\n')  strcat(reply,"\n");
+       send(fd,reply,strlen(reply),MSG_NOSIGNAL);
+       close(fd);
+       fflush(stdout);
+   }
+
+   return 0;
+}
@@ -0,0 +1,144 @@
+// Protocol of the work unit coordinator, see coordinator.c.
+// The workers ( euler -worker address [options], euler413 -worker address R R0 y|n ) connect for each request,
+// send one line and read the reply line, address is host:port for TCP or the path of a local socket.
+// A unit is a residue i mod p of euler.c or an a0 class of euler413.c: a0=8*unit+1, 0<=unit<=2047.
+//
+// LEASE <search> <first> <last> <worker>        asks for a unit, search names the program and its parameters ( without spaces ),
+//                                               first..last are the units of the worker. The coordinator takes them from
+//                                               its first worker and refuses the workers of an other search.
+//    UNIT <unit> <lease> <heartbeat>            search the unit and send a HEARTBEAT in every heartbeat seconds
+//    WAIT <seconds>                             all unfinished units are leased, ask again after this
+//    DONE                                       all units are finished
+//    ERROR <text>
+// HEARTBEAT <unit> <lease>                      OK, or LOST if the lease timed out and the unit is given to an other worker
+// SOLUTION <unit> <lease> <text>                OK, the solution is appended to coordinator_solutions.txt if it isn't there yet
+// RESULT <unit> <lease> <seconds> <solutions>   OK, the unit is finished, also if the lease timed out
+// FAIL <unit> <lease> <text>                    OK, the unit is given back, for example the worker is stopped
+// STATUS                                        the state of the search in more lines, then the connection is closed
+
+#ifndef COORDINATOR_H
+#define COORDINATOR_H
+
+#define COORDINATOR_ADDRESS "127.0.0.1:5413"  // the default address of the coordinator
+#define COORDINATOR_LINE 1024  // the longest line of the protocol
+#define COORDINATOR_TIMEOUT 600  // the default lease timeout in seconds, the heartbeat is a quarter of it
+#define WORKER_RETRIES 30  // a worker tries to reach the coordinator this many times
+#define WORKER_RETRY_WAIT 10  // waiting this many seconds after a failed try
+
+#include <stdio.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <sys/time.h>
+#include <netdb.h>
+
+// The client of the protocol and the address parsing are here, so the coordinator and both workers share them.
+// They are static, so each program includes its own copy without an other source file to compile.
+
+static inline int coordinator_socket(char *address, int listening)
+{
+// a socket of the address host:port or of the path of a local socket, bound and listening or connected.
+// Returns -1 on error.
+   struct sockaddr_un local;
+   struct addrinfo hints,*res;
+   char host[COORDINATOR_LINE],*port;
+   int fd,one=1;
+
+   if(strchr(address,'/')!=NULL)  {
+      memset(&local,0,sizeof(local));
+      local.sun_family=AF_UNIX;
+      strncpy(local.sun_path,address,sizeof(local.sun_path)-1);
+      fd=socket(AF_UNIX,SOCK_STREAM,0);
+      if(fd<0)  return -1;
+      if(listening)  {
+         unlink(address);
+         if(bind(fd,(struct sockaddr*) &local,sizeof(local))||listen(fd,64))  return close(fd),-1;
+      }
+      else if(connect(fd,(struct sockaddr*) &local,sizeof(local)))  return close(fd),-1;
+      return fd;
+   }
+   strncpy(host,address,COORDINATOR_LINE-1);
+   host[COORDINATOR_LINE-1]=0;
+   port=strrchr(host,':');
+   if(port==NULL)  return -1;
+   *port++=0;
+   memset(&hints,0,sizeof(hints));
+   hints.ai_family=AF_UNSPEC;
+   hints.ai_socktype=SOCK_STREAM;
+   if(listening)  hints.ai_flags=AI_PASSIVE;
+   if(getaddrinfo(host,port,&hints,&res))  return -1;
+   fd=socket(res->ai_family,res->ai_socktype,res->ai_protocol);
+   if(fd>=0)  {
+      if(listening)  {
+         setsockopt(fd,SOL_SOCKET,SO_REUSEADDR,&one,sizeof(one));
+         if(bind(fd,res->ai_addr,res->ai_addrlen)||listen(fd,64))  close(fd),fd=-1;
+      }
+      else if(connect(fd,res->ai_addr,res->ai_addrlen))  close(fd),fd=-1;
+   }
+   freeaddrinfo(res);
+
+   return fd;
+}
+
+static inline unsigned long int coordinator_request(char *address, char *request, char *reply)
+{
+// sends the request line to the coordinator at address and reads the reply line ( at most COORDINATOR_LINE chars )
+// without the newline. Returns 0 on success and 1 if the coordinator can't be reached.
+   struct timeval wait;
+   char line[COORDINATOR_LINE+2];
+   long int len,n;
+   int fd;
+
+   fd=coordinator_socket(address,0);
+   if(fd<0)  return 1;
+   wait.tv_sec=30,wait.tv_usec=0;
+   setsockopt(fd,SOL_SOCKET,SO_RCVTIMEO,&wait,sizeof(wait));
+   setsockopt(fd,SOL_SOCKET,SO_SNDTIMEO,&wait,sizeof(wait));
+   len=snprintf(line,COORDINATOR_LINE+2,"%s\n",request);
+   if(send(fd,line,len,MSG_NOSIGNAL)!=len)  {
+      close(fd);
+      return 1;
+   }
+   len=0;
+   while((len<COORDINATOR_LINE)&&((n=recv(fd,reply+len,COORDINATOR_LINE-len,0))>0))  {
+      len+=n;
+      if(memchr(reply,'\n',len)!=NULL)  break;
+   }
+   close(fd);
+   reply[len]=0;
+   if(memchr(reply,'\n',len)==NULL)  return 1;
+   reply[strcspn(reply,"\r\n")]=0;
+
+   return 0;
+}
+
+static inline unsigned long int worker_request(char *address, char *request, char *reply)
+{
+// coordinator_request() with WORKER_RETRIES tries, so the coordinator can be restarted meanwhile
+   unsigned long int j;
+
+   for(j=0;j<WORKER_RETRIES;j++)  {
+       if(!coordinator_request(address,request,reply))  return 0;
+       printf("Cannot reach the coordinator at %s, trying again in %d sec\n",address,WORKER_RETRY_WAIT);
+       sleep(WORKER_RETRY_WAIT);
+   }
+
+   return 1;
+}
+
+static inline unsigned long int coordinator_heartbeat(char *address, volatile unsigned long int *unit, volatile unsigned long int *lease)
+{
+// sends the heartbeat of the lease *lease of *unit from the timer thread of a worker, returns the lease if the
+// coordinator gave its unit to an other worker and 0 if not. The worker can go on to the next unit meanwhile,
+// then the reply is about the previous one and it is ignored.
+   char request[COORDINATOR_LINE],reply[COORDINATOR_LINE+1];
+   unsigned long int u=*unit,l=*lease;
+
+   sprintf(request,"HEARTBEAT %lu %lu",u,l);
+   if((!coordinator_request(address,request,reply))&&(!strcmp(reply,"LOST"))&&(u==*unit)&&(l==*lease))  return l;
+
+   return 0;
+}
+
+#endif
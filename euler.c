@@ -3,379 +3,2163 @@
 // One of them of c,d,e,f,g can be zero and/or one of them of a,b can be zero.
 //
 // Version 1.0
+// Modified to save the work and stop at SIGTERM/SIGINT, compile with -lm -lpthread
+// Modified to be usable also as a library, see euler.h
+// Modified to search more residues at once: euler -threads N [-memory MB]
+// Modified to search the second stage of a residue by more threads
+// Modified to use 32-bit tables and to store only e/7,f/7 of the triplets
+// Modified to keep R and L sorted by the q and p residues instead of chaining
+// Modified to choose p,q,r and the table sizes from the Range given on the command line
+// Modified to save the finished residues and the positions in an atomic checkpoint, so the residues can be finished in any order
+// Modified to probe R in batches with prefetching in the second stage
+// Modified to keep a,b of the pairs in L, so a fingerprint match is checked without searching a,b,c,d again
+// Modified to search also other Euler(n,2,5) systems, see euler.h for the -DEXPONENT=n -DPOWER_PRIME=P -DPOWER_EXPONENT=E flags
+// Modified to filter the f values of the first stage with AVX2/AVX-512 if the compiler targets them ( for example with -march=native )
+// Modified to pass the (e,f) grid of the first stage once, staging the triplets and partitioning them by the q residue
+// Modified to read the L tables of the second stage from a memory-mapped cache file: euler -lcache file
+// Modified to search a batch of residues with one second stage sweep: euler -batch N
+// Modified to benchmark the parts of the search and to find the known solutions again with a small Range: euler -bench
+// Modified to write the table fill, the bucket sizes and the fingerprint matches of each residue: euler -stats file
+// Modified to grow the tables if a residue or a k value has more entries than estimated and to join the L buckets in place
+// Modified to probe R slice after slice in the second stage, so the probed part of R stays in the cache: euler -slices N
+// Modified to join the pairs with R also by sorting the probes and merging them with R: euler -join merge
+// Modified to lease the residues from a coordinator, see coordinator.c: euler -worker address
 //
 
 #include <stdio.h>
 #include <stdlib.h>
+#include <math.h>
+#include <string.h>
+#include <ctype.h>
 #include <time.h>
+#include <signal.h>
+#include <pthread.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/resource.h>
+#include "euler.h"
+#include "coordinator.h"
+#if defined(__AVX512F__)||defined(__AVX2__)
+#include <immintrin.h>
+#endif
 
-unsigned long int powmod6(unsigned long int a, unsigned long int p)
+#define TIME_INTERVAL 600  // 600 seconds (update interval)
+#define STOP_TIMEOUT 20  // after a signal exit in at most this many seconds even if the k value isn't finished
+#define MAX_RANGE (POWER_PRIME*65536)  // e/P and f/P of a triplet are stored in 16 bits
+#define STR(x) STR2(x)
+#define STR2(x) #x
+#define SYSTEM "(" STR(EXPONENT) ",2,5)"
+#define POW "^" STR(EXPONENT)
+#define FALSE_POSITIVES 16.0  // the expected number of false fingerprint matches for a residue, with q and r chosen automatically
+#define K_CHUNK 49  // the parallel second stage gives out this many k values at once
+#define PROBE_BATCH 32  // the probes of R in the second stage are resolved in groups of this many
+#define MAX_BATCH 64  // at most this many residues share a second stage sweep, see -batch
+#define MAX_SLICES 4096  // R is probed in at most this many slices, see -slices
+#define SLICE_PROBES 262144  // the sliced and the merge join of the second stage stage this many probes at once
+#define RADIX_BITS 11  // the merge join sorts the probes by digits of this many bits
+#define MEMORY_PERCENT 75  // the default memory budget of -threads is this percent of the physical memory
+#define PLAN_TIME 60  // in the -plan mode sample units for at least this many seconds
+#define PLAN_RESIDUES 3  // number of sampled residues in the -plan mode
+#define PLAN_MIN_SAMPLES 20  // and at least this many k values of each class for each residue
+#define PLAN_MAX_JOBS_LIST 64  // list the suggested jobs only if there are at most this many
+#define BENCH_RESIDUES 3  // the -bench mode times the first stage of this many fixed residues
+#define BENCH_K 40  // and the L build and the join of this many fixed k values
+#define BENCH_CHECKS 10000  // and about this many hit checks
+#define STATS_HIST 16  // the histograms of the bucket sizes in -stats have this many bins, the last one is for the larger buckets
+#define STATS_WARN 0.9  // warn if a table is filled above this
+#define BENCH_RANGE 1200  // the Range of the scaled-down search of the -bench mode, the known solutions are below it
+#define LCACHE_MAGIC 0x45554c4552434131UL  // "EULERCA1", the first word of an L cache file
+#define LCACHE_HEADER 8  // words of the header of an L cache file, then the index of POWER_MODULUS words
+
+   static unsigned long int Range=(POWER_MODULUS<MAX_RANGE)?POWER_MODULUS:MAX_RANGE;  // search a,b,c,d,e,f,g<Range, it can be given by -range
+   static unsigned long int p=0;  // p is prime, p>Range and gcd(p-1,n)==2, chosen by choose_parameters()
+   static unsigned int *remp;
+   static unsigned int *rempm;  // rempm[j]=remp[P*j], so the multiples of P are contiguous
+   static unsigned int *Inversep;
+   static unsigned long int primes[16]={100000007,100000037,100000039,100000049,100000073,100000081,100000123,100000127,
+                                 100000193,100000213,100000217,100000223,100000231,100000237,100000259,100000267};
+   static unsigned long int num_primes;  // the first num_primes of them are enough for a solution check, set by choose_parameters()
+   static unsigned long int filter_primes[16],num_filter_primes;  // one of e,f,g is divisible by these, besides 2,3 and P
+
+   static unsigned int *R=NULL,*L;
+   static unsigned long int table_size_L;  // p+2 bucket starts and the pairs of one k value with their a,b values
+   static unsigned long int table_size_pairs;  // the pairs of one k value
+   static unsigned long int table_size_triplets;  // the triplets of one residue
+   static unsigned long int table_size_R;  // q+2 bucket starts and table_size_triplets fingerprints
+   // these are estimates with 10% slack, a table is grown if a residue or a k value has more,
+   // the most triplets of a residue and pairs of a k is kept to report how close the run came to the estimates
+   static unsigned long int max_triplets=0,max_pairs=0,num_grown=0;
+   static unsigned long int q=0;  // q is prime, if it is 0 then choose_parameters() sets it about the number of triplets
+   static unsigned int *remq;
+   static unsigned long int r=0;  // r is prime, if it is 0 then choose_parameters() sets it for the false_positives rate
+   static unsigned int *remr;
+   static double false_positives=FALSE_POSITIVES;
+   static double expected_false=0.0;  // the expected number of false fingerprint matches for a residue with q,r
+   static unsigned int *rempowerP;  // x^n mod POWER_MODULUS
+   static unsigned int *InversepowerP;  // the roots of x^n==u mod POWER_MODULUS are at u<=j<u+POWER_PRIME-1, their number at u-1
+   static unsigned int *triplets;
+   static unsigned long int *lcache=NULL;  // the mapped L cache file, NULL if the L tables are built for each k
+
+   static euler_context* context=NULL;  // set by euler_init(), NULL in the program
+   static long int built_residue=-1;  // R holds the first stage of this residue, -1 if there is no such
+
+   static pthread_mutex_t result_lock=PTHREAD_MUTEX_INITIALIZER;  // the solutions can be found by more threads at once
+   static pthread_mutex_t stats_lock=PTHREAD_MUTEX_INITIALIZER;  // the k values of a residue can be searched by more threads at once, also guards stats_file
+   static unsigned long int num_slices=1;  // -slices: R is probed in this many slices of the q residues, 1 probes it at once
+   static unsigned long int merge_join=0;  // -join merge: the probes are sorted and merged with R instead of probing R at random
+
+#ifndef EULER_LIBRARY
+   // only the program: the checkpoints, the scheduling of the threads and the worker
+   static unsigned long int lcache_size;
+   static volatile sig_atomic_t stop_request=0;  // set by SIGTERM/SIGINT, the search stops before the next k value
+   static volatile sig_atomic_t save_request=0;  // set by the timer thread in every TIME_INTERVAL seconds
+   static pthread_mutex_t work_lock=PTHREAD_MUTEX_INITIALIZER;  // only one checkpoint is written at once
+   static FILE* stats_file=NULL;  // -stats: a JSON line for each residue, NULL if it isn't written
+   static pthread_mutex_t sched_lock=PTHREAD_MUTEX_INITIALIZER;  // guards the following
+   static unsigned long int sched_start,sched_end,next_residue,lowest_unfinished;
+   static unsigned char *finished;  // bitmap of the finished residues of the job, bit i-sched_start
+   static unsigned long int num_progress=0,size_progress=0,*progress_i,*progress_k;  // the unfinished residues with their lowest unfinished k
+   static unsigned long int batch_size=1;  // the residues of a batch, set by parallel_search()
+   static char *worker_address=NULL;  // -worker: the address of the coordinator, NULL if the residues aren't leased from one
+   static unsigned long int worker_unit,worker_lease,worker_heartbeat,worker_solutions;  // the leased residue
+   static volatile sig_atomic_t worker_active=0;  // a residue is leased and searched now
+   static volatile unsigned long int lost_lease=0;  // set by the timer thread to the lease if the coordinator gave its unit to an other worker
+#endif
+
+typedef struct  {
+   unsigned long int k_values;  // the k values searched in this run
+   unsigned long int triplets,R_size,R_max,R_hist[STATS_HIST];  // the triplets in R, the room in R, its largest bucket and the bucket sizes
+   unsigned long int pairs_max,L_size,L_max,L_hist[STATS_HIST];  // the most pairs of a k, the room in L, the largest bucket of L and the bucket sizes for all k
+   unsigned long int probes;  // the probes of R
+   unsigned long int hits;  // the l values with a matching fingerprint, counted once by check_hit()
+   unsigned long int matches;  // the triplets with a matching fingerprint in check_hit()
+   unsigned long int solutions;  // the matches passing the primes[] check
+} search_stats;
+
+typedef struct  {
+   unsigned long int num_res;  // the residues of the batch, 0 if there is none
+   unsigned long int i[MAX_BATCH];
+   unsigned int *R[MAX_BATCH],*triplets[MAX_BATCH];  // the first stage of i[b], read-only in the second stage
+   unsigned long int size[MAX_BATCH];  // R[b],triplets[b] have room for this many triplets
+   search_stats stats[MAX_BATCH];  // the statistics of i[b] for -stats
+   unsigned long int next_k;  // the next chunk of the second stage starts here
+   unsigned long int num_threads;
+   unsigned long int *current;  // current[t] is the first k of the chunk of thread t, POWER_MODULUS if it has none
+   pthread_mutex_t lock;
+} stage_two_job;
+
+typedef struct  {
+   unsigned int key,fp;  // the q residue and the fingerprint of c^n+d^n+e^n... from a pair of the join
+   unsigned long int l;  // the p residue of a^n+b^n
+   unsigned int start,end;  // the bucket of key in R
+} probe;
+
+typedef struct  {
+   unsigned int key,fp,l;  // a probe staged for the sliced or the merge join, see join_staged()
+} slice_probe;
+
+typedef struct  {
+   stage_two_job* job;
+   unsigned int *L;  // private L table of the thread
+   unsigned long int L_size;  // it has room for this many pairs
+   unsigned long int t;
+} stage_two_thread;
+
+#ifndef EULER_LIBRARY
+   static stage_two_job *jobs;  // one for each residue that is searched at once
+#endif
+
+static unsigned long int powmodn(unsigned long int a, unsigned long int p)
 {
-  unsigned long long int K,h=a;
-  
-  K=(h*h)%p;
-  K=(K*h)%p;
-  K=(K*K)%p;
-  
+// a^n mod p for p<2^32, n=EXPONENT is a constant, so the compiler can unroll the loop
+  unsigned long long int K=1,h=a%p;
+  unsigned long int e;
+
+  for(e=EXPONENT;e>0;e>>=1)  {
+      if(e&1)  K=(K*h)%p;
+      if(e>1)  h=(h*h)%p;
+  }
+
   return K;
 }
 
-int main (int argc, char *argv[])  {
+static unsigned long int gcd(unsigned long int a, unsigned long int b)
+{
+   unsigned long int t;
 
-   unsigned long int Range=117649;  // this is 7^6, the same as power7
-   unsigned long int p=117659;  // p is prime, p>Range and p==2 mod 3
-   unsigned long int *remp;
-   unsigned long int *Inversep;
-   unsigned long int start_rem_p=0;
-   unsigned long int end_rem_p=p-1;
-   unsigned long int primes[5]={100000007,100000037,100000039,100000049,100000073}; // sufficient for Range=117649
+   while(b>0)  t=a%b,a=b,b=t;
 
-   unsigned long int a,b,c,d,e,f,g,h,i,j,k,l,m,n,nextpos,np,num,num2,pos,pre_p,pre_q,pre_r,prm,s,st,start_f,test,u,w;
-   signed long int w2,w3;
+   return a;
+}
 
-   unsigned long int A[2],numb[2],temp[2],duo[512];
-   unsigned long int *R,*L;
-   unsigned long int table_size_L=1100000;
-   unsigned long int table_size_R=12000000;
-   unsigned long int q=4200013;  // q is prime
-   unsigned long int *remq;
-   unsigned long int r=1000000007;  // r is prime
-   unsigned long int *remr;
-   unsigned long int power7=117649;  // this is 7^6
-   unsigned long int *rempower7;
-   unsigned long int *Inversepower7;
-   unsigned long int *triplets;
-
-   unsigned long int percent,update;
+static unsigned long int is_prime(unsigned long int n)
+{
+   unsigned long int d;
 
-   time_t seconds;
-   
-   L=(unsigned long int*) (malloc) (table_size_L*sizeof(unsigned long int));
+   if(n<2)  return 0;
+   for(d=2;d*d<=n;d++)
+       if(n%d==0)  return 0;
+
+   return 1;
+}
+
+static unsigned long int next_prime(unsigned long int n)
+{
+// the smallest prime that is at least n
+   while(!is_prime(n))  n++;
+
+   return n;
+}
+
+static unsigned long int choose_parameters(void)
+{
+// p is the smallest prime above Range with gcd(p-1,n)==2, so x^n==u mod p has 0 or 2 roots.
+// The triplets are filtered by the primes P', where x^n mod P'^j is 0 or 1 for a P'^j>5: then 3 of c,d,e,f,g
+// are divisible by P', so one of e,f,g also. These are 2 (j=3), 3 if 3|n (j=2) and the primes P'>=5 found below.
+// From the expected counts, where M=Range/P:
+// triplets of a residue: about M^3/6/p*(1-(1-1/P')^3) for each P', q is the next prime above it so a bucket of R holds one of them on average,
+// pairs of a k value: about ((P-1)*M)^2/2/P^(E-1) for k%P==2 and (P-1)*M^2/P^(E-1) for k%P==1,
+// probes of a residue: P^(E-1) values of k and p values of l, each joins about pairs^2/p^2 duos,
+// r is chosen so that the expected number of false fingerprint matches for a residue is false_positives.
+// Returns 1 for bad parameters.
+   double M,triplets_est,pairs_est,pairs1_est,probes,fp,prod;
+   unsigned long int j,m,x,u;
+
+   if((!is_prime(POWER_PRIME))||(Range<2*POWER_PRIME)||(Range>MAX_RANGE))  {
+      printf("Bad Range or POWER_PRIME, it should be a prime and 2*POWER_PRIME<=Range<=%d\n",MAX_RANGE);
+      return 1;
+   }
+   p=Range+1;
+   while((gcd(p-1,EXPONENT)!=2)||(!is_prime(p)))  p++;
+
+   num_filter_primes=0;
+   for(j=5;(j<=EXPONENT+1)&&(num_filter_primes<16);j++)  {
+       if((!is_prime(j))||(j==POWER_PRIME))  continue;
+       for(m=j;m<6;m*=j);
+       for(x=0;x<m;x++)  {
+           u=powmodn(x,m);
+           if(u>1)  break;
+       }
+       if(x==m)  filter_primes[num_filter_primes++]=j;
+   }
+
+   // the difference of the two sides is below 5*Range^n if it isn't zero
+   prod=log(5.0)+EXPONENT*log((double) Range);
+   for(num_primes=0;(num_primes<16)&&(prod>0.0);num_primes++)  prod-=log((double) primes[num_primes]);
+   if(prod>0.0)  {
+      printf("Too large Range for the solution check, it needs more than 16 primes\n");
+      return 1;
+   }
+
+   M=(double) (Range+POWER_PRIME-1)/POWER_PRIME;
+   triplets_est=M*M*M/6.0/p*(7.0/8.0);
+   if(EXPONENT%3==0)  triplets_est*=19.0/27.0;
+   for(j=0;j<num_filter_primes;j++)  triplets_est*=1.0-pow(1.0-1.0/filter_primes[j],3.0);
+   pairs_est=((POWER_PRIME-1)*M)*((POWER_PRIME-1)*M)/2.0/(POWER_MODULUS/POWER_PRIME);
+   pairs1_est=((POWER_PRIME-1)*M)*M/(POWER_MODULUS/POWER_PRIME);
+   if(q==0)  q=next_prime((unsigned long int) triplets_est+1);
+   probes=(double) (POWER_MODULUS/POWER_PRIME)*(pairs_est*pairs_est+pairs1_est*pairs1_est)/p;
+   fp=probes*triplets_est/q;
+   if(r==0)  {
+      if(fp/false_positives>4294967291.0)  {
+         r=4294967291UL;  // the largest prime below 2^32, the fingerprints are 32 bits
+         printf("With 32-bit fingerprints about %.1f false matches are expected for each residue\n",fp/r);
+      }
+      else  r=next_prime((unsigned long int) (fp/false_positives)+1);
+   }
+   if((q>=4294967296UL)||(r>=4294967296UL))  {
+      printf("Bad q or r, they should be below 2^32\n");
+      return 1;
+   }
+
+   // the tables have 10% slack, the counts are checked when the tables are filled
+   table_size_triplets=(unsigned long int) (1.1*triplets_est)+1024;
+   table_size_R=q+2+table_size_triplets;
+   table_size_pairs=(unsigned long int) (1.1*pairs_est)+1024;
+   table_size_L=p+2+4*table_size_pairs;
 
-   R=(unsigned long int*) (malloc) (table_size_R*sizeof(unsigned long int));
+   expected_false=fp/r;
+   printf("Range=%ld, p=%ld, q=%ld, r=%ld, expected false matches for each residue: %.1f\n",Range,p,q,r,fp/r);
 
-   triplets=(unsigned long int*) (malloc) ((3*table_size_R/2)*sizeof(unsigned long int));
+   return 0;
+}
+
+static void build_tables(void)
+{
+   unsigned long int i,u;
+
+   L=(unsigned int*) (malloc) (table_size_L*sizeof(unsigned int));
+
+   R=(unsigned int*) (malloc) (table_size_R*sizeof(unsigned int));
+
+   triplets=(unsigned int*) (malloc) (table_size_triplets*sizeof(unsigned int));
 
-   rempower7=(unsigned long int*) (malloc) (power7*sizeof(unsigned long int));
-   Inversepower7=(unsigned long int*) (malloc) (power7*sizeof(unsigned long int));
+   rempowerP=(unsigned int*) (malloc) (POWER_MODULUS*sizeof(unsigned int));
+   InversepowerP=(unsigned int*) (malloc) (POWER_MODULUS*sizeof(unsigned int));
 
-   remp=(unsigned long int*) (malloc) (p*sizeof(unsigned long int));
-   Inversep=(unsigned long int*) (malloc) (p*sizeof(unsigned long int));
+   remp=(unsigned int*) (malloc) (p*sizeof(unsigned int));
+   Inversep=(unsigned int*) (malloc) (p*sizeof(unsigned int));
+   rempm=(unsigned int*) (malloc) ((Range/POWER_PRIME+1)*sizeof(unsigned int));
 
-   remq=(unsigned long int*) (malloc) (Range*sizeof(unsigned long int));
+   remq=(unsigned int*) (malloc) (Range*sizeof(unsigned int));
 
-   remr=(unsigned long int*) (malloc) (Range*sizeof(unsigned long int));
+   remr=(unsigned int*) (malloc) (Range*sizeof(unsigned int));
 
    for(i=0;i<Range;i++)  {
-       remq[i]=powmod6(i,q);
-       remr[i]=powmod6(i,r);
+       remq[i]=powmodn(i,q);
+       remr[i]=powmodn(i,r);
    }  
 
    for(i=0;i<p;i++)  Inversep[i]=p;
    for(i=0;i<p;i++)  {
-       u=powmod6(i,p);
+       u=powmodn(i,p);
        remp[i]=u;
        Inversep[u]=i;
    }
+   for(i=0;i*POWER_PRIME<Range;i++)  rempm[i]=remp[i*POWER_PRIME];
+
+   for(i=0;i<POWER_MODULUS;i++) InversepowerP[i]=0;
+   for(i=0;i<POWER_MODULUS;i++)  {
+       u=powmodn(i,POWER_MODULUS);
+       rempowerP[i]=u;
+       if(u>0) InversepowerP[u+InversepowerP[u-1]]=i,InversepowerP[u-1]++;
+   }
+
+   return;
+}
+
+static void free_tables(void)
+{
+   free(remp);
+   free(rempm);
+   free(Inversep);
+   free(R);
+   free(L);
+   free(remq);
+   free(remr);
+   free(rempowerP);
+   free(InversepowerP);
+   free(triplets);
+
+   return;
+}
+
+static unsigned long int filter_triplet(unsigned long int e, unsigned long int f, unsigned long int g)
+{
+// one of e,f,g is divisible by each of the filter_primes
+   unsigned long int j;
+
+   for(j=0;j<num_filter_primes;j++)
+       if((e%filter_primes[j])&&(f%filter_primes[j])&&(g%filter_primes[j]))  return 0;
+
+   return 1;
+}
+
+static unsigned long int third_of_triplet(unsigned long int i, unsigned long int e, unsigned long int f)
+{
+// only e/P and f/P is stored in the triplets table, g comes from e^n+f^n+g^n==i mod p as in the first stage:
+// from the two roots g and p-g only one is divisible by P, because p%P>0
+   unsigned long int g,u;
+
+   u=remp[e]+remp[f];
+   if(u>=p)  u-=p;
+   if(u<=i)  u=i-u;
+   else      u=i+p-u;
+   g=Inversep[u];
+   if(g%POWER_PRIME)  g=p-g;
+
+   return g;
+}
+
+#if defined(__AVX512F__)
+static unsigned long int filter_f(unsigned long int i, unsigned long int e, unsigned long int start_f, unsigned int *listf, unsigned int *listg)
+{
+// 16 f values at once, the same tests as in the scalar version below
+   unsigned long int j,n,num=0;
+   unsigned int invP=POWER_PRIME;
+   __m512i vf,vu,vg;
+   __mmask16 live,div;
+   const __m512i one=_mm512_set1_epi32(1),zero=_mm512_setzero_si512();
+   const __m512i vp=_mm512_set1_epi32(p),vi=_mm512_set1_epi32(i),vpre=_mm512_set1_epi32(remp[e]),vrange=_mm512_set1_epi32(Range);
+   const __m512i inv3=_mm512_set1_epi32(0xaaaaaaab),lim3=_mm512_set1_epi32(0x55555555);  // 3*inv3==1 mod 2^32
+   const __m512i limP=_mm512_set1_epi32(0xffffffffU/POWER_PRIME),vstep=_mm512_set1_epi32(16*POWER_PRIME);
+   __m512i vinvP;
+
+   for(j=0;j<5;j++)  invP*=2-POWER_PRIME*invP;  // POWER_PRIME*invP==1 mod 2^32
+   vinvP=_mm512_set1_epi32(invP);
+   if(start_f>=Range)  return 0;
+   n=(Range-start_f+POWER_PRIME-1)/POWER_PRIME;
+   vf=_mm512_add_epi32(_mm512_set1_epi32(start_f),_mm512_mullo_epi32(_mm512_setr_epi32(0,1,2,3,4,5,6,7,8,9,10,11,12,13,14,15),
+                                                                         _mm512_set1_epi32(POWER_PRIME)));
+   for(j=0;j<n;j+=16,vf=_mm512_add_epi32(vf,vstep))  {
+       live=0xffff;
+       if(n-j<16)  live=(1<<(n-j))-1;
+       // u=i-e^n-f^n mod p, the wraps are done by unsigned minimums
+       vu=_mm512_add_epi32(vpre,_mm512_maskz_loadu_epi32(live,rempm+start_f/POWER_PRIME+j));
+       vu=_mm512_min_epu32(vu,_mm512_sub_epi32(vu,vp));
+       vu=_mm512_sub_epi32(vi,vu);
+       vu=_mm512_min_epu32(vu,_mm512_add_epi32(vu,vp));
+       vg=_mm512_mask_i32gather_epi32(zero,live,vu,(int const*) Inversep,4);
+       // a number is divisible by P iff multiplied by the inverse it is at most limP, take the root that is divisible
+       div=_mm512_mask_cmple_epu32_mask(live,_mm512_mullo_epi32(vg,vinvP),limP);
+       vg=_mm512_mask_blend_epi32(div,_mm512_sub_epi32(vp,vg),vg);
+       live=_mm512_mask_cmple_epu32_mask(live,_mm512_mullo_epi32(vg,vinvP),limP);
+       live=_mm512_mask_cmpge_epu32_mask(live,vg,vf);
+       live=_mm512_mask_cmplt_epu32_mask(live,vg,vrange);
+       if(e&1)  live=_mm512_mask_testn_epi32_mask(live,_mm512_and_si512(vf,vg),one);
+       if((EXPONENT%3==0)&&(e%3))
+          live=_mm512_mask_cmple_epu32_mask(live,_mm512_mullo_epi32(vf,inv3),lim3)|
+               _mm512_mask_cmple_epu32_mask(live,_mm512_mullo_epi32(vg,inv3),lim3);
+       _mm512_mask_compressstoreu_epi32(listf+num,live,vf);
+       _mm512_mask_compressstoreu_epi32(listg+num,live,vg);
+       num+=_mm_popcnt_u32(live);
+   }
+   return num;
+}
+#elif defined(__AVX2__)
+static unsigned long int filter_f(unsigned long int i, unsigned long int e, unsigned long int start_f, unsigned int *listf, unsigned int *listg)
+{
+// 8 f values at once, the same tests as in the scalar version below
+   unsigned long int j,n,num=0,bits;
+   unsigned int invP=POWER_PRIME;
+   unsigned int lanesf[8],lanesg[8];
+   __m256i vf,vu,vg,vh,live,div;
+   const __m256i one=_mm256_set1_epi32(1),zero=_mm256_setzero_si256(),lane=_mm256_setr_epi32(0,1,2,3,4,5,6,7);
+   const __m256i vp=_mm256_set1_epi32(p),vi=_mm256_set1_epi32(i),vpre=_mm256_set1_epi32(remp[e]),vrange=_mm256_set1_epi32(Range-1);
+   const __m256i inv3=_mm256_set1_epi32(0xaaaaaaab),lim3=_mm256_set1_epi32(0x55555555);  // 3*inv3==1 mod 2^32
+   const __m256i limP=_mm256_set1_epi32(0xffffffffU/POWER_PRIME),vstep=_mm256_set1_epi32(8*POWER_PRIME);
+   __m256i vinvP;
+
+   for(j=0;j<5;j++)  invP*=2-POWER_PRIME*invP;  // POWER_PRIME*invP==1 mod 2^32
+   vinvP=_mm256_set1_epi32(invP);
+   if(start_f>=Range)  return 0;
+   n=(Range-start_f+POWER_PRIME-1)/POWER_PRIME;
+   vf=_mm256_add_epi32(_mm256_set1_epi32(start_f),_mm256_mullo_epi32(lane,_mm256_set1_epi32(POWER_PRIME)));
+   for(j=0;j<n;j+=8,vf=_mm256_add_epi32(vf,vstep))  {
+       live=_mm256_cmpgt_epi32(_mm256_set1_epi32(n-j),lane);
+       // u=i-e^n-f^n mod p, the wraps are done by unsigned minimums
+       vu=_mm256_add_epi32(vpre,_mm256_maskload_epi32((int const*) rempm+start_f/POWER_PRIME+j,live));
+       vu=_mm256_min_epu32(vu,_mm256_sub_epi32(vu,vp));
+       vu=_mm256_sub_epi32(vi,vu);
+       vu=_mm256_min_epu32(vu,_mm256_add_epi32(vu,vp));
+       vg=_mm256_mask_i32gather_epi32(zero,(int const*) Inversep,vu,live,4);
+       // a number is divisible by P iff multiplied by the inverse it is at most limP, take the root that is divisible
+       vh=_mm256_mullo_epi32(vg,vinvP);
+       div=_mm256_cmpeq_epi32(_mm256_min_epu32(vh,limP),vh);
+       vg=_mm256_blendv_epi8(_mm256_sub_epi32(vp,vg),vg,div);
+       vh=_mm256_mullo_epi32(vg,vinvP);
+       live=_mm256_and_si256(live,_mm256_cmpeq_epi32(_mm256_min_epu32(vh,limP),vh));
+       live=_mm256_and_si256(live,_mm256_cmpeq_epi32(_mm256_max_epu32(vg,vf),vg));  // g>=f
+       live=_mm256_and_si256(live,_mm256_cmpeq_epi32(_mm256_min_epu32(vg,vrange),vg));  // g<Range
+       if(e&1)  live=_mm256_and_si256(live,_mm256_cmpeq_epi32(_mm256_and_si256(_mm256_and_si256(vf,vg),one),zero));
+       if((EXPONENT%3==0)&&(e%3))  {
+          vh=_mm256_mullo_epi32(vf,inv3);
+          div=_mm256_cmpeq_epi32(_mm256_min_epu32(vh,lim3),vh);
+          vh=_mm256_mullo_epi32(vg,inv3);
+          div=_mm256_or_si256(div,_mm256_cmpeq_epi32(_mm256_min_epu32(vh,lim3),vh));
+          live=_mm256_and_si256(live,div);
+       }
+       bits=_mm256_movemask_ps(_mm256_castsi256_ps(live));
+       if(bits)  {
+          _mm256_storeu_si256((__m256i*) lanesf,vf);
+          _mm256_storeu_si256((__m256i*) lanesg,vg);
+          for(;bits;bits&=bits-1)  listf[num]=lanesf[__builtin_ctz(bits)],listg[num]=lanesg[__builtin_ctz(bits)],num++;
+       }
+   }
+   return num;
+}
+#else
+static unsigned long int filter_f(unsigned long int i, unsigned long int e, unsigned long int start_f, unsigned int *listf, unsigned int *listg)
+{
+// collect the f values start_f, start_f+P, ... below Range with the third g of the triplet: e^n+f^n+g^n==i mod p,
+// f<=g<Range, P|g, one of e,f,g is even and one of them is divisible by 3 if 3|n
+   unsigned long int f,g,h,num=0,pre_p,u;
+   unsigned long int temp[2];
+
+   pre_p=remp[e];
+   for(f=start_f;f<Range;f+=POWER_PRIME)  {
+       u=pre_p+remp[f];
+       if(u>=p)  u-=p;
+       if(u<=i)  u=i-u;
+       else      u=i+p-u;
+       temp[0]=Inversep[u],temp[1]=p-temp[0];
+       for(h=0;h<=1;h++)  {
+           g=temp[h];
+           if((g>=f)&&((g%POWER_PRIME)==0)&&((e&1)+(f&1)+(g&1)<3)&&((EXPONENT%3)||(e%3==0)||(f%3==0)||(g%3==0))&&(g<Range))
+              listf[num]=f,listg[num]=g,num++;
+       }
+   }
+   return num;
+}
+#endif
+
+static unsigned long int grow_size(unsigned long int num)
+{
+// a table that overflowed with num entries is grown with the same slack as in choose_parameters()
+   pthread_mutex_lock(&stats_lock);
+   num_grown++;
+   pthread_mutex_unlock(&stats_lock);
+
+   return (unsigned long int) (1.1*num)+1024;
+}
+
+static unsigned long int generate_triplets(unsigned long int i, unsigned int *R, unsigned int **staged, unsigned long int *size)
+{
+// the triplets of the residue i from filter_f() are staged as e/P,f/P in the order they are found
+// and R[s+2] is the number of them with (e^n+f^n+g^n)%q==s, returns the number of the triplets.
+// *staged has room for *size triplets, it is grown if there are more of them.
+   unsigned long int e,f,g,h,j,num,num_f,pos,pre_q,start_f;
+   unsigned int *listf,*listg;
+
+   listf=(unsigned int*) (malloc) ((Range/POWER_PRIME+1)*sizeof(unsigned int));
+   listg=(unsigned int*) (malloc) ((Range/POWER_PRIME+1)*sizeof(unsigned int));
+   for(j=0;j<q+2;j++)  R[j]=0;
+   num=0;
+   for(e=0;e<Range;e+=POWER_PRIME)  {
+       if(e==0) start_f=POWER_PRIME;
+       else     start_f=e;
+       pre_q=remq[e];
+       num_f=filter_f(i,e,start_f,listf,listg);
+       for(h=0;h<num_f;h++)  {
+           f=listf[h],g=listg[h];
+           if((num_filter_primes>0)&&(!filter_triplet(e,f,g)))  continue;
+           pos=pre_q+remq[f]+remq[g];
+           if(pos>=q)  pos-=q;
+           if(pos>=q)  pos-=q;
+           if(num==*size)  {
+              *size=grow_size(num+1);
+              *staged=(unsigned int*) (realloc) (*staged,(*size)*sizeof(unsigned int));
+              if(*staged==NULL)  {
+                 printf("Not enough memory for the triplets of remainder=%ld, sorry.\nExit.\n",i);
+                 exit(1);
+              }
+           }
+           R[pos+2]++;
+           (*staged)[num++]=((e/POWER_PRIME)<<16)+f/POWER_PRIME;
+       }
+   }
+   free(listf);
+   free(listg);
+
+   return num;
+}
+
+static void partition_triplets(unsigned long int i, unsigned long int num, unsigned int *R, unsigned int *staged, unsigned int *triplets)
+{
+// moves the staged triplets of generate_triplets() to their buckets ( a radix partition by the q residue ),
+// g is found again from e,f as in third_of_triplet()
+   unsigned long int e,f,g,h,j,pos,w;
+   unsigned int *fingerprint=R+q+2;
+
+   // R[s+2] is the size of the bucket s, after this R[s+1] is the start of it
+   for(j=2;j<q+2;j++)  R[j]+=R[j-1];
+   for(j=0;j<num;j++)  {
+       e=POWER_PRIME*(staged[j]>>16);
+       f=POWER_PRIME*(staged[j]&65535);
+       g=third_of_triplet(i,e,f);
+       pos=remq[e]+remq[f]+remq[g];
+       if(pos>=q)  pos-=q;
+       if(pos>=q)  pos-=q;
+       w=remr[e]+remr[f]+remr[g];
+       if(w>=r)  w-=r;
+       if(w>=r)  w-=r;
+       h=R[pos+1]++;
+       fingerprint[h]=w;
+       triplets[h]=staged[j];
+   }
+
+   return;
+}
+
+static void grow_triplet_tables(unsigned long int i, unsigned long int num, unsigned int **table_R, unsigned int **table_triplets,
+                         unsigned long int *size)
+{
+// the tables of a residue have room for *size triplets, they are grown if it has num>*size triplets,
+// the bucket counts of generate_triplets() are kept by realloc()
+   if(num>*size)  {
+      printf("Remainder=%ld has %ld triplets, more than the %ld of the tables, they are grown.\n",i,num,*size);
+      *size=grow_size(num);
+      *table_R=(unsigned int*) (realloc) (*table_R,(q+2+(*size))*sizeof(unsigned int));
+      *table_triplets=(unsigned int*) (realloc) (*table_triplets,(*size)*sizeof(unsigned int));
+      if((*table_R==NULL)||(*table_triplets==NULL))  {
+         printf("Not enough memory for the triplets of remainder=%ld, sorry.\nExit.\n",i);
+         exit(1);
+      }
+   }
+   pthread_mutex_lock(&stats_lock);
+   if(num>max_triplets)  max_triplets=num;
+   pthread_mutex_unlock(&stats_lock);
+
+   return;
+}
+
+static void first_stage(unsigned long int i, unsigned int **table_R, unsigned int **table_triplets, unsigned long int *size)
+{
+// *table_R and *table_triplets are the tables of the caller, in the parallel search each residue has its own,
+// they have room for *size triplets and they are grown if the residue has more
+// e^n+f^n+g^n==i mod p where e<=f<=g, P|e,f,g and at least one of them is even
+// and at least one of them is divisible by 3 if 3|n and by each of the filter_primes
+// if e=0 then f>0
+// R is sorted by the q residue: the triplets with (e^n+f^n+g^n)%q==s are at R[s]<=j<R[s+1], their
+// fingerprint (e^n+f^n+g^n)%r is in R[q+2+j] and their e/P,f/P is in triplets[j].
+// The (e,f) grid is passed only once: the triplets are counted by their bucket and staged, then partitioned.
+   unsigned long int num,staged_size;
+   unsigned int *staged;
+
+   staged_size=*size;
+   staged=(unsigned int*) (malloc) (staged_size*sizeof(unsigned int));
+   num=generate_triplets(i,*table_R,&staged,&staged_size);
+   grow_triplet_tables(i,num,table_R,table_triplets,size);
+   partition_triplets(i,num,*table_R,staged,*table_triplets);
+   free(staged);
+
+   return;
+}
+
+static void report_solution(unsigned long int a, unsigned long int b, unsigned long int c, unsigned long int d,
+                     unsigned long int e, unsigned long int f, unsigned long int g)
+{
+   FILE* out;
+#ifndef EULER_LIBRARY
+   char request[COORDINATOR_LINE],reply[COORDINATOR_LINE+1];
+#endif
+
+   pthread_mutex_lock(&result_lock);
+   if((context!=NULL)&&(context->solution!=NULL))  {
+      context->solution(context->user,a,b,c,d,e,f,g);
+   }
+   else {
+      printf("Solution found! %ld" POW "+%ld" POW "=%ld" POW "+%ld" POW "+%ld" POW "+%ld" POW "+%ld" POW "                \n",a,b,c,d,e,f,g);
+      out=fopen("euler_" SYSTEM ".txt","a+");
+      fprintf(out,"Solution found! %ld" POW "+%ld" POW "=%ld" POW "+%ld" POW "+%ld" POW "+%ld" POW "+%ld" POW "\n",a,b,c,d,e,f,g);
+      fclose(out);
+   }
+#ifndef EULER_LIBRARY
+   if(worker_address!=NULL)  {
+      sprintf(request,"SOLUTION %ld %ld Solution found! %ld" POW "+%ld" POW "=%ld" POW "+%ld" POW "+%ld" POW "+%ld" POW "+%ld" POW,
+              worker_unit,worker_lease,a,b,c,d,e,f,g);
+      worker_solutions++;
+   }
+#endif
+   pthread_mutex_unlock(&result_lock);
+#ifndef EULER_LIBRARY
+   // sent with one try after the unlock, so the other threads don't wait for an unreachable coordinator,
+   // the solution is also in the file of the worker
+   if((worker_address!=NULL)&&coordinator_request(worker_address,request,reply))
+      printf("Cannot send the solution to the coordinator at %s, it is in euler_" SYSTEM ".txt\n",worker_address);
+#endif
+
+   return;
+}
+
+static unsigned long int probe_batch(unsigned int *R, probe *batch, unsigned long int num, unsigned long int *hits)
+{
+// Group prefetching: the buckets of the probes were prefetched when the keys were computed, here the
+// fingerprints of all nonempty buckets are prefetched before the first one is read, so the cache misses
+// of a batch overlap. Returns the number of the different l values with a matching fingerprint,
+// these are in hits[] in increasing order.
+   unsigned int *fingerprint=R+q+2;  // see first_stage
+   unsigned long int h,j,num_hits=0;
+
+   for(h=0;h<num;h++)  {
+       batch[h].start=R[batch[h].key];
+       batch[h].end=R[batch[h].key+1];
+       if(batch[h].start<batch[h].end)  __builtin_prefetch(fingerprint+batch[h].start);
+   }
+   for(h=0;h<num;h++)
+       for(j=batch[h].start;j<batch[h].end;j++)
+           if(fingerprint[j]==batch[h].fp)  {
+              if((num_hits==0)||(hits[num_hits-1]!=batch[h].l))  hits[num_hits++]=batch[h].l;
+              break;
+           }
+
+   return num_hits;
+}
+
+static void check_hit(unsigned long int i, unsigned long int l, unsigned int *R, unsigned int *L, unsigned int *triplets, search_stats *stats)
+{
+// a fingerprint of R matched for a^n+b^n==l mod p: the a,b values are in the bucket l of L and
+// the c,d values in the bucket l-i ( see second_stage ), join them again and check the matching triplets
+   unsigned long int a,b,c,d,e,f,g,j,m,n,np,prm,test,u;
+   signed long int w2,w3,z;
+
+   unsigned int *fingerprint=R+q+2;
+   unsigned int *Lpair=L+p+2;
+
+   // each path of the second stage calls this once for each l with a matching fingerprint, so the hits are counted here
+   if(stats!=NULL)  stats->hits++;
+   if(l>=i)  u=l-i;
+   else      u=l+p-i;
+   for(m=L[l];m<L[l+1];m++)  {
+       for(n=L[u];n<L[u+1];n++)  {
+           w3=(signed long int) Lpair[4*m+1]-Lpair[4*n+1];
+           if(w3<0)  w3+=q;
+           w2=(signed long int) Lpair[4*m]-Lpair[4*n];
+           if(w2<0)  w2+=r;
+           for(j=R[w3];j<R[w3+1];j++)  {
+               if(fingerprint[j]!=w2)  continue;
+               if(stats!=NULL)  stats->matches++;
+               a=Lpair[4*m+2],b=Lpair[4*m+3];
+               c=Lpair[4*n+2],d=Lpair[4*n+3];
+               e=POWER_PRIME*(triplets[j]>>16);
+               f=POWER_PRIME*(triplets[j]&65535);
+               g=third_of_triplet(i,e,f);
+               test=1;
+               for(np=0;np<num_primes;np++)  {
+                   prm=primes[np];
+                   z=(powmodn(a,prm)+powmodn(b,prm))%prm;
+                   z-=(powmodn(c,prm)+powmodn(d,prm)+powmodn(e,prm)+powmodn(f,prm)+powmodn(g,prm))%prm;
+                   if(z<0) z+=prm;
+                   if(z!=0) test=0;
+               }
+               if(test)  {
+                  if(stats!=NULL)  stats->solutions++;
+                  report_solution(a,b,c,d,e,f,g);
+               }
+           }
+        }
+    }
+
+   return;
+}
+
+static int compare_l(const void *x, const void *y)
+{
+   unsigned int a=*(const unsigned int*) x,b=*(const unsigned int*) y;
+
+   return (a>b)-(a<b);
+}
+
+static unsigned long int probe_slices(unsigned long int num, slice_probe *staged, slice_probe *part, unsigned int *R, unsigned int *found)
+{
+// The sliced probing of R for -slices: the q residues are cut into num_slices ranges, a slice of R is a contiguous part of
+// its bucket starts and fingerprints. The num staged probes are partitioned by their slice into part[] ( a radix partition
+// as in partition_triplets() ) and R is probed slice after slice, so the buckets of a slice are read from the cache
+// instead of the memory after their first miss. Returns the number of the l values with a matching fingerprint in found[].
+   unsigned long int h,j,n,num_found,num_hits,s,slice_mul;
+   unsigned long int count[MAX_SLICES],hits[PROBE_BATCH];
+   probe batch[PROBE_BATCH];
+
+   // the slice of a key<q is key*num_slices/q rounded down ( or one less ), without a division
+   slice_mul=(num_slices<<32)/q;
+   for(s=0;s<num_slices;s++)  count[s]=0;
+   for(j=0;j<num;j++)  count[(staged[j].key*slice_mul)>>32]++;
+   for(s=1,h=count[0],count[0]=0;s<num_slices;s++)  n=count[s],count[s]=h,h+=n;
+   for(j=0;j<num;j++)  part[count[(staged[j].key*slice_mul)>>32]++]=staged[j];
+
+   num_found=0;
+   for(j=0;j<num;j+=PROBE_BATCH)  {
+       n=(num-j<PROBE_BATCH)?num-j:PROBE_BATCH;
+       for(h=0;h<n;h++)  {
+           batch[h].key=part[j+h].key;
+           batch[h].fp=part[j+h].fp;
+           batch[h].l=part[j+h].l;
+           __builtin_prefetch(R+batch[h].key);
+       }
+       num_hits=probe_batch(R,batch,n,hits);
+       for(h=0;h<num_hits;h++)  found[num_found++]=hits[h];
+   }
+
+   return num_found;
+}
+
+static unsigned long int probe_merge(unsigned long int num, slice_probe *staged, slice_probe *part, unsigned int *R, unsigned int *found)
+{
+// The sort-merge join of -join merge: the num staged probes are sorted by their q residue with an LSD radix sort of
+// RADIX_BITS digits ( staged[] and part[] are used in turns ), then R is read in the order of its buckets: a bucket
+// is read once for all of its probes and the bucket starts and the fingerprints are read forward, skipping the buckets
+// without a probe. Returns the number of the l values with a matching fingerprint in found[].
+   unsigned long int h,j,key,n,num_found,shift,s,st,en;
+   unsigned long int count[1<<RADIX_BITS];
+   unsigned int *fingerprint=R+q+2;
+   slice_probe *from=staged,*to=part,*t;
+
+   for(shift=0;(q-1)>>shift;shift+=RADIX_BITS)  {
+       memset(count,0,sizeof(count));
+       for(j=0;j<num;j++)  count[(from[j].key>>shift)&((1<<RADIX_BITS)-1)]++;
+       for(s=1,h=count[0],count[0]=0;s<(1<<RADIX_BITS);s++)  n=count[s],count[s]=h,h+=n;
+       for(j=0;j<num;j++)  to[count[(from[j].key>>shift)&((1<<RADIX_BITS)-1)]++]=from[j];
+       t=from,from=to,to=t;
+   }
+
+   num_found=0;
+   for(j=0;j<num;j=h)  {
+       key=from[j].key;
+       st=R[key],en=R[key+1];
+       for(h=j;(h<num)&&(from[h].key==key);h++)
+           for(s=st;s<en;s++)
+               if(fingerprint[s]==from[h].fp)  {
+                  found[num_found++]=from[h].l;
+                  break;
+               }
+   }
+
+   return num_found;
+}
+
+static void join_staged(unsigned long int i, unsigned long int num, slice_probe *staged, slice_probe *part, unsigned int *found,
+                 unsigned int *R, unsigned int *L, unsigned int *triplets, unsigned long int *last_hit, search_stats *stats)
+{
+// joins the num staged probes of the residue i with R by the sliced or the merge join, the l values with a matching
+// fingerprint are sorted and checked once, *last_hit is the last checked l, the probes of one l can be in two calls
+   unsigned long int h,num_found;
+
+   if(merge_join)  num_found=probe_merge(num,staged,part,R,found);
+   else            num_found=probe_slices(num,staged,part,R,found);
+   if(num_found>1)  qsort(found,num_found,sizeof(unsigned int),compare_l);
+   for(h=0;h<num_found;h++)  {
+       if(found[h]==*last_hit)  continue;
+       check_hit(i,found[h],R,L,triplets,stats);
+       *last_hit=found[h];
+   }
+
+   return;
+}
 
-   for(i=0;i<power7;i++) Inversepower7[i]=0;
-   for(i=0;i<power7;i++)  {
-       u=powmod6(i,power7);
-       rempower7[i]=u;
-       if(u>0) Inversepower7[u+Inversepower7[u-1]]=i,Inversepower7[u-1]++;
+static void build_L(unsigned long int k, unsigned int **table, unsigned long int *size)
+{
+// the pairs a^n+b^n==k mod POWER_MODULUS, where k%P is 1 or 2, these don't depend on the residue of the first stage.
+// *table has room for *size pairs, it is grown if there are more of them.
+   unsigned long int a,b,j,l,m,pass,pos,pre_p,pre_q,pre_r,s,st,w;
+   unsigned int *L=*table;
+   unsigned int *Lpair=L+p+2;
+
+   // L is sorted by the p residue: the pairs with (a^n+b^n)%p==l are at L[l]<=j<L[l+1], (a^n+b^n)%r is in
+   // Lpair[4*j], (a^n+b^n)%q is in Lpair[4*j+1] and a>=b is in Lpair[4*j+2],Lpair[4*j+3], these are read only
+   // by check_hit(). It is built in two passes: counting the buckets and then filling them.
+   for(l=0;l<p+2;l++)  L[l]=0;
+   for(pass=0;pass<2;pass++)  {
+   if(k%POWER_PRIME==1)  {
+      for(l=k;l<k+POWER_PRIME-1;l++)  {
+          for(a=InversepowerP[l];a<Range;a+=POWER_MODULUS)  {  // the roots of a^n==k mod P^E are below P^E
+          pre_p=remp[a];
+          pre_q=remq[a];
+          pre_r=remr[a];
+          for(b=0;b<Range;b+=POWER_PRIME)  {
+              pos=pre_p+remp[b];
+              if(pos>=p)  pos-=p;
+              if(pass==0)  L[pos+2]++;
+              else {
+                 s=pre_q+remq[b];
+                 if(s>=q) s-=q;
+                 w=pre_r+remr[b];
+                 if(w>=r)  w-=r;
+                 j=L[pos+1]++;
+                 Lpair[4*j]=w;
+                 Lpair[4*j+1]=s;
+                 if(a>b)  Lpair[4*j+2]=a,Lpair[4*j+3]=b;
+                 else     Lpair[4*j+2]=b,Lpair[4*j+3]=a;
+              }
+           }
+          }
+       }
+    }
+    else {
+       for(l=1;l<POWER_PRIME;l++)  {
+            for(a=l;a<Range;a+=POWER_PRIME)  {
+                st=rempowerP[a%POWER_MODULUS];
+                if(k>=st)  st=k-st;
+                else       st=k+POWER_MODULUS-st;
+                pre_p=remp[a];
+                pre_q=remq[a];
+                pre_r=remr[a];
+                for(m=st;m<st+POWER_PRIME-1;m++)  {
+                    for(b=InversepowerP[m];a>=b;b+=POWER_MODULUS)  {  // symmetric rule
+                       pos=pre_p+remp[b];
+                       if(pos>=p) pos-=p;
+                       if(pass==0)  L[pos+2]++;
+                       else {
+                          s=pre_q+remq[b];
+                          if(s>=q) s-=q;
+                          w=pre_r+remr[b];
+                          if(w>=r) w-=r;
+                          j=L[pos+1]++;
+                          Lpair[4*j]=w;
+                          Lpair[4*j+1]=s;
+                          Lpair[4*j+2]=a;
+                          Lpair[4*j+3]=b;
+                       }
+                    }
+                 }
+              }
+         }
+      }
+      if(pass==0)  {
+         // L[l+2] is the size of the bucket l, after this L[l+1] is the start of it
+         for(l=2;l<p+2;l++)  L[l]+=L[l-1];
+         if(L[p+1]>*size)  {
+            *size=grow_size(L[p+1]);
+            L=(unsigned int*) (realloc) (L,(p+2+4*(*size))*sizeof(unsigned int));
+            if(L==NULL)  {
+               printf("Not enough memory for the pairs of k=%ld, sorry.\nExit.\n",k);
+               exit(1);
+            }
+            *table=L,Lpair=L+p+2;
+         }
+      }
    }
 
+   return;
+}
+
+#ifndef EULER_LIBRARY
+static unsigned long int build_lcache(char *name)
+{
+// The L table of each k is written after each other as it is in the memory, the header is LCACHE_MAGIC and the
+// parameters of the search, then the byte offset of the table of each k ( 0 if k%P isn't 1 or 2 ).
+// It is written to a temporary file and renamed, so a stopped build or a failed write doesn't leave a bad cache.
+   unsigned long int k,offset,percent,update,error;
+   unsigned long int header[LCACHE_HEADER];
+   unsigned long int *index;
+   char *tmp_name;
+   FILE* cachefile;
+
+   tmp_name=(char*) (malloc) (strlen(name)+5);
+   sprintf(tmp_name,"%s.tmp",name);
+   cachefile=fopen(tmp_name,"wb");
+   if(cachefile==NULL)  {
+      printf("Cannot write the L cache %s!\n",tmp_name);
+      free(tmp_name);
+      return 1;
+   }
+   index=(unsigned long int*) (calloc) (POWER_MODULUS,sizeof(unsigned long int));
+   header[0]=LCACHE_MAGIC,header[1]=EXPONENT,header[2]=POWER_PRIME,header[3]=POWER_EXPONENT;
+   header[4]=Range,header[5]=p,header[6]=q,header[7]=r;
+   error=(fwrite(header,sizeof(unsigned long int),LCACHE_HEADER,cachefile)!=LCACHE_HEADER);
+   error|=(fwrite(index,sizeof(unsigned long int),POWER_MODULUS,cachefile)!=POWER_MODULUS);
+   offset=(LCACHE_HEADER+POWER_MODULUS)*sizeof(unsigned long int);
+   update=0;
+   printf("Building the L cache %s\n",name);
+   for(k=0;(k<POWER_MODULUS)&&(!error);k++)  {
+       if((k%POWER_PRIME!=1)&&(k%POWER_PRIME!=2))  continue;
+       build_L(k,&L,&table_size_pairs);
+       index[k]=offset;
+       offset+=(p+2+4*L[p+1])*sizeof(unsigned int);
+       error=(fwrite(L,sizeof(unsigned int),p+2+4*L[p+1],cachefile)!=p+2+4*L[p+1]);
+       percent=(int) (double) 100.0*k/POWER_MODULUS;
+       if(percent>update) update=percent,printf("    %ld percentage of the L cache is complete. [ %.1f GB ]\r\r",update,offset/1073741824.0),fflush(stdout);
+   }
+   if(!error)  {
+      error=(fseek(cachefile,LCACHE_HEADER*sizeof(unsigned long int),SEEK_SET)!=0);
+      error|=(fwrite(index,sizeof(unsigned long int),POWER_MODULUS,cachefile)!=POWER_MODULUS);
+      error|=(fflush(cachefile)!=0);
+      error|=(fsync(fileno(cachefile))!=0);
+   }
+   error|=(fclose(cachefile)!=0);
+   if((!error)&&rename(tmp_name,name))  error=1;
+   free(index);
+   if(error)  {
+      printf("Cannot write the L cache %s, is the disk full?\n",tmp_name);
+      unlink(tmp_name);
+      free(tmp_name);
+      return 1;
+   }
+   printf("Complete the L cache, its size is %.1f GB.                \n",offset/1073741824.0);
+   free(tmp_name);
+
+   return 0;
+}
+
+static unsigned long int open_lcache(char *name)
+{
+// maps the L cache read-only, it is shared by all threads, returns 1 if it is missing, it is for an other search
+// or the table of a k doesn't fit in the file
+   int fd;
+   struct stat st;
+   unsigned long int k,offset,*map;
+   unsigned int *table;
+
+   fd=open(name,O_RDONLY);
+   if(fd<0)  return 1;
+   if((fstat(fd,&st)<0)||(st.st_size<0)||((unsigned long int) st.st_size<(LCACHE_HEADER+POWER_MODULUS)*sizeof(unsigned long int)))  {
+      close(fd);
+      printf("The L cache %s is truncated.\n",name);
+      return 1;
+   }
+   map=(unsigned long int*) mmap(NULL,st.st_size,PROT_READ,MAP_SHARED,fd,0);
+   close(fd);
+   if(map==MAP_FAILED)  {
+      printf("Cannot map the L cache %s.\n",name);
+      return 1;
+   }
+   if((map[0]!=LCACHE_MAGIC)||(map[1]!=EXPONENT)||(map[2]!=POWER_PRIME)||(map[3]!=POWER_EXPONENT)||
+      (map[4]!=Range)||(map[5]!=p)||(map[6]!=q)||(map[7]!=r))  {
+      printf("The L cache %s is for an other Range,p,q,r, delete it or give an other file.\n",name);
+      munmap(map,st.st_size);
+      return 1;
+   }
+   for(k=0;k<POWER_MODULUS;k++)  {
+       if((k%POWER_PRIME!=1)&&(k%POWER_PRIME!=2))  continue;
+       offset=map[LCACHE_HEADER+k];
+       table=(unsigned int*) ((char*) map+offset);
+       if((offset<(LCACHE_HEADER+POWER_MODULUS)*sizeof(unsigned long int))||(offset%sizeof(unsigned int))||
+          (offset>(unsigned long int) st.st_size)||((p+2)*sizeof(unsigned int)>st.st_size-offset)||
+          ((p+2+4*(unsigned long int) table[p+1])*sizeof(unsigned int)>st.st_size-offset))  {
+          printf("The L cache %s is truncated or damaged at k=%ld, delete it.\n",name,k);
+          munmap(map,st.st_size);
+          return 1;
+       }
+   }
+   lcache=map,lcache_size=st.st_size;
+   printf("Using the L cache %s ( %.1f GB )\n",name,lcache_size/1073741824.0);
+
+   return 0;
+}
+
+static void close_lcache(void)
+{
+   if(lcache!=NULL)  munmap(lcache,lcache_size);
+   lcache=NULL;
+
+   return;
+}
+#endif
+
+static void bucket_stats(unsigned int *T, unsigned long int num, unsigned long int *max, unsigned long int *hist)
+{
+// the sizes of the buckets T[j]<=x<T[j+1] for j<num are added to hist and the largest one to max
+   unsigned long int j,u;
+
+   for(j=0;j<num;j++)  {
+       u=T[j+1]-T[j];
+       if(u>*max)  *max=u;
+       hist[(u<STATS_HIST-1)?u:STATS_HIST-1]++;
+   }
+
+   return;
+}
+
+static void add_stats(search_stats *to, search_stats *from)
+{
+   unsigned long int j;
+
+   to->k_values+=from->k_values;
+   if(from->pairs_max>to->pairs_max)  to->pairs_max=from->pairs_max;
+   if(from->L_size>to->L_size)  to->L_size=from->L_size;
+   if(from->L_max>to->L_max)  to->L_max=from->L_max;
+   for(j=0;j<STATS_HIST;j++)  to->L_hist[j]+=from->L_hist[j];
+   to->probes+=from->probes;
+   to->hits+=from->hits;
+   to->matches+=from->matches;
+   to->solutions+=from->solutions;
+
+   return;
+}
+
+#ifndef EULER_LIBRARY
+static void write_stats(unsigned long int i, search_stats *st)
+{
+// a JSON line for the residue i, with a warning if a table is almost full. The expected false matches
+// are for the k values of this run.
+   unsigned long int j;
+   double expected;
+
+   expected=expected_false*st->k_values/(2*(POWER_MODULUS/POWER_PRIME));
+   pthread_mutex_lock(&stats_lock);
+   fprintf(stats_file,"{\"residue\":%ld,\"k_values\":%ld,\"triplets\":%ld,\"table_size_triplets\":%ld,\"R_bucket_max\":%ld,\"R_hist\":[",
+           i,st->k_values,st->triplets,st->R_size,st->R_max);
+   for(j=0;j<STATS_HIST;j++)  fprintf(stats_file,"%s%ld",(j>0)?",":"",st->R_hist[j]);
+   fprintf(stats_file,"],\"pairs_max\":%ld,\"table_size_pairs\":%ld,\"L_bucket_max\":%ld,\"L_hist\":[",
+           st->pairs_max,st->L_size,st->L_max);
+   for(j=0;j<STATS_HIST;j++)  fprintf(stats_file,"%s%ld",(j>0)?",":"",st->L_hist[j]);
+   fprintf(stats_file,"],\"probes\":%ld,\"fingerprint_hits\":%ld,\"fingerprint_matches\":%ld,\"solutions\":%ld,",
+           st->probes,st->hits,st->matches,st->solutions);
+   fprintf(stats_file,"\"false_matches\":%ld,\"expected_false_matches\":%.2f,\"q\":%ld,\"r\":%ld}\n",
+           st->matches-st->solutions,expected,q,r);
+   fflush(stats_file);
+   pthread_mutex_unlock(&stats_lock);
+   if(st->triplets>STATS_WARN*st->R_size)
+      printf("Warning: R is %.0f%% full at remainder=%ld\n",100.0*st->triplets/st->R_size,i);
+   if((lcache==NULL)&&(st->pairs_max>STATS_WARN*st->L_size))
+      printf("Warning: L is %.0f%% full at remainder=%ld\n",100.0*st->pairs_max/st->L_size,i);
+
+   return;
+}
+
+static void report_fill(void)
+{
+// how close the run came to the table sizes of choose_parameters()
+   pthread_mutex_lock(&stats_lock);
+   if(max_triplets>0)
+      printf("The most triplets of a residue: %ld, %.1f%% of the planned size of R ( %ld ).\n",max_triplets,100.0*max_triplets/table_size_triplets,table_size_triplets);
+   if(max_pairs>0)
+      printf("The most pairs of a k value: %ld, %.1f%% of the planned size of L ( %ld ).\n",max_pairs,100.0*max_pairs/table_size_pairs,table_size_pairs);
+   if(num_grown>0)  printf("A table was grown %ld times.\n",num_grown);
+   pthread_mutex_unlock(&stats_lock);
+
+   return;
+}
+
+static void first_stage_stats(search_stats *st, unsigned int *R, unsigned long int size)
+{
+// starts the statistics of a residue from its first stage, R has room for size triplets
+   memset(st,0,sizeof(search_stats));
+   st->triplets=R[q+1];
+   st->R_size=size;
+   bucket_stats(R,q,&st->R_max,st->R_hist);
+
+   return;
+}
+#endif
+
+static void second_stage(unsigned long int num_res, unsigned long int *res, unsigned long int k, unsigned int **R, unsigned int **own_L,
+                  unsigned long int *own_size, unsigned int **triplets, search_stats *stats)
+{
+// a^n+b^n==k mod POWER_MODULUS, where k%P is 1 or 2, joined with the triplets of the residues res[0..num_res-1]
+// in R[0..num_res-1]. L is built in the table *own_L of the caller ( for *own_size pairs, it is grown if k has more )
+// or it points into the L cache, then it is read-only and serves all residues.
+// If stats isn't NULL then the statistics of res[b] are added to stats[b].
+   unsigned long int b,h,i,l,m,n,num,num_hits,u;
+   signed long int w2,w3;
+
+   unsigned long int hits[PROBE_BATCH],nb[MAX_BATCH],last_hit[MAX_BATCH];
+   probe batch[MAX_BATCH][PROBE_BATCH];
+   search_stats local[MAX_BATCH];
+   unsigned int *L,*Lpair,*found;
+   slice_probe *staged,*part;
+   char *start;
+
+   if(lcache!=NULL)  {
+      L=(unsigned int*) ((char*) lcache+lcache[LCACHE_HEADER+k]);
+      // the pages of the table are read ahead from the disk, the join reads its buckets in random order
+      start=(char*) L-((unsigned long int) L)%sysconf(_SC_PAGESIZE);
+      madvise(start,(char*) (L+p+2+4*L[p+1])-start,MADV_WILLNEED);
+   }
+   else  {
+      build_L(k,own_L,own_size);
+      L=*own_L;
+   }
+   Lpair=L+p+2;
+   // read and written under the lock, as max_triplets, the other threads update it meanwhile
+   pthread_mutex_lock(&stats_lock);
+   if(L[p+1]>max_pairs)  max_pairs=L[p+1];
+   pthread_mutex_unlock(&stats_lock);
+   if(stats!=NULL)  {
+      memset(local,0,sizeof(search_stats));
+      local[0].k_values=1;
+      local[0].pairs_max=L[p+1];
+      local[0].L_size=(lcache!=NULL)?L[p+1]:*own_size;
+      bucket_stats(L,p,&local[0].L_max,local[0].L_hist);
+      for(b=1;b<num_res;b++)  local[b]=local[0];
+   }
+   for(b=0;b<num_res;b++)  nb[b]=0,last_hit[b]=p;
+   if((num_slices>1)||merge_join)  {
+      // the probes of a residue are staged by SLICE_PROBES and joined with R[b] by join_staged(),
+      // the residues of the batch are joined one after the other so the buffers are shared
+      staged=(slice_probe*) (malloc) (SLICE_PROBES*sizeof(slice_probe));
+      part=(slice_probe*) (malloc) (SLICE_PROBES*sizeof(slice_probe));
+      found=(unsigned int*) (malloc) (SLICE_PROBES*sizeof(unsigned int));
+      for(b=0;b<num_res;b++)  {
+          i=res[b];
+          num=0;
+          for(l=0;l<p;l++)  {
+              if(L[l]==L[l+1])  continue;
+              if(l>=i)  u=l-i;
+              else      u=l+p-i;
+              if(stats!=NULL)  local[b].probes+=(unsigned long int) (L[l+1]-L[l])*(L[u+1]-L[u]);
+              for(m=L[l];m<L[l+1];m++)  {
+                  for(n=L[u];n<L[u+1];n++)  {
+                      w3=(signed long int) Lpair[4*m+1]-Lpair[4*n+1];
+                      if(w3<0)  w3+=q;
+                      w2=(signed long int) Lpair[4*m]-Lpair[4*n];
+                      if(w2<0)  w2+=r;
+                      if(num==SLICE_PROBES)  {
+                         join_staged(i,num,staged,part,found,R[b],L,triplets[b],last_hit+b,(stats!=NULL)?local+b:NULL);
+                         num=0;
+                      }
+                      staged[num].key=w3;
+                      staged[num].fp=w2;
+                      staged[num].l=l;
+                      num++;
+                  }
+              }
+          }
+          join_staged(i,num,staged,part,found,R[b],L,triplets[b],last_hit+b,(stats!=NULL)?local+b:NULL);
+      }
+      free(staged);
+      free(part);
+      free(found);
+   }
+   else  {
+      // the probes of R[b] are collected in batch[b] by PROBE_BATCH, these can be from more l values,
+      // last_hit[b] is the last checked l, so an l with hits in two batches is checked only once
+      for(l=0;l<p;l++)  {  // a^n+b^n==l mod p, from this c^n+d^n==l-i mod p for each residue i
+      // the buckets are contiguous in Lpair, so they are read in place: (a^n+b^n)%r=Lpair[4*m],
+      // (a^n+b^n)%q=Lpair[4*m+1] and (c^n+d^n)%r=Lpair[4*n], (c^n+d^n)%q=Lpair[4*n+1], a bucket can have any size
+          if(L[l]==L[l+1])  continue;
+          for(b=0;b<num_res;b++)  {
+          i=res[b];
+          if(l>=i)  u=l-i;
+          else      u=l+p-i;
+          if(stats!=NULL)  local[b].probes+=(unsigned long int) (L[l+1]-L[l])*(L[u+1]-L[u]);
+            for(m=L[l];m<L[l+1];m++)  {
+                for(n=L[u];n<L[u+1];n++)  {
+                    w3=(signed long int) Lpair[4*m+1]-Lpair[4*n+1];
+                    if(w3<0)  w3+=q;
+                    w2=(signed long int) Lpair[4*m]-Lpair[4*n];
+                    if(w2<0)  w2+=r;
+                    batch[b][nb[b]].key=w3;
+                    batch[b][nb[b]].fp=w2;
+                    batch[b][nb[b]].l=l;
+                    __builtin_prefetch(R[b]+w3);
+                    nb[b]++;
+                    if(nb[b]==PROBE_BATCH)  {
+                       num_hits=probe_batch(R[b],batch[b],nb[b],hits);
+                       for(h=0;h<num_hits;h++)
+                           if(hits[h]!=last_hit[b])  check_hit(i,hits[h],R[b],L,triplets[b],(stats!=NULL)?local+b:NULL),last_hit[b]=hits[h];
+                       nb[b]=0;
+                    }
+                 }
+            }
+          }
+        }
+      for(b=0;b<num_res;b++)  {
+          num_hits=probe_batch(R[b],batch[b],nb[b],hits);
+          for(h=0;h<num_hits;h++)
+              if(hits[h]!=last_hit[b])  check_hit(res[b],hits[h],R[b],L,triplets[b],(stats!=NULL)?local+b:NULL);
+      }
+   }
+   if(stats!=NULL)  {
+      pthread_mutex_lock(&stats_lock);
+      for(b=0;b<num_res;b++)  add_stats(stats+b,local+b);
+      pthread_mutex_unlock(&stats_lock);
+   }
+
+   return;
+}
+
+int euler_init(euler_context* ctx)
+{
+   context=ctx;
+   if(R==NULL)  {
+      if(ctx->Range>0)  Range=ctx->Range;
+      if(choose_parameters())  return 1;
+      build_tables();
+   }
+   built_residue=-1;
+   ctx->p=p;
+
+   return 0;
+}
+
+int euler_search_unit(euler_context* ctx, unsigned long int i, unsigned long int k)
+{
+   if((ctx!=context)||(R==NULL))  return 1;
+   if((i>=p)||(k>=POWER_MODULUS)||((k%POWER_PRIME!=1)&&(k%POWER_PRIME!=2)))  return 1;
+
+   if(built_residue!=(long int) i)  {
+      first_stage(i,&R,&triplets,&table_size_triplets);
+      built_residue=i;
+   }
+   second_stage(1,&i,k,&R,&L,&table_size_pairs,&triplets,NULL);
+
+   return 0;
+}
+
+int euler_search_residue(euler_context* ctx, unsigned long int i, unsigned long int start_k)
+{
+   unsigned long int k;
+
+   if((ctx!=context)||(R==NULL)||(i>=p))  return 1;
+
+   for(k=start_k;k<POWER_MODULUS;k++)  {
+       if((k%POWER_PRIME==1)||(k%POWER_PRIME==2))  {
+          euler_search_unit(ctx,i,k);
+          if(ctx->progress!=NULL)  ctx->progress(ctx->user,i,k);
+       }
+   }
+
+   return 0;
+}
+
+void euler_free(euler_context* ctx)
+{
+   if(R!=NULL)  free_tables();
+   R=NULL;
+   q=0,r=0;
+   built_residue=-1;
+   context=NULL;
+
+   return;
+}
+
+#ifndef EULER_LIBRARY
+static void plan_work(unsigned long int start_rem_p, unsigned long int end_rem_p, double hours)
+{
+// dry run for the -plan mode: time the first stage of a few random residues and a random sample
+// of the second stage k values for them, and extrapolate the cost of the whole residue interval.
+// The k%P==1 and k%P==2 units have very different cost, so these are sampled separately.
+   unsigned long int c,i,j,k,num_res,shards,first,last;
+   unsigned long int n[3];
+   double t,mean,var,total,total_var,low,high,memory,units[3],sum[3],sum2[3];
+   clock_t start,res_start,unit_start;
+
+   num_res=end_rem_p-start_rem_p+1;
+   srand(time(NULL));
+   for(c=0;c<3;c++)  n[c]=0,sum[c]=0.0,sum2[c]=0.0;
+   // c=0 is the first stage of a residue, c=1,2 is a second stage unit with k%P==c
+   units[0]=(double) num_res;
+   units[1]=(double) num_res*(POWER_MODULUS/POWER_PRIME);
+   units[2]=(double) num_res*(POWER_MODULUS/POWER_PRIME);
+   start=clock();
+   for(j=0;j<PLAN_RESIDUES;j++)  {
+       i=start_rem_p+((((unsigned long int) rand())<<15)^rand())%num_res;
+       printf("Sampling remainder=%ld\n",i);
+       res_start=clock();
+       first_stage(i,&R,&triplets,&table_size_triplets);
+       t=(double) (clock()-res_start)/CLOCKS_PER_SEC;
+       sum[0]+=t,sum2[0]+=t*t,n[0]++;
+       c=1;
+       res_start=clock();
+       while((n[1]<PLAN_MIN_SAMPLES*(j+1))||(n[2]<PLAN_MIN_SAMPLES*(j+1))||(clock()-res_start<PLAN_TIME*CLOCKS_PER_SEC/PLAN_RESIDUES))  {
+             k=POWER_PRIME*(((((unsigned long int) rand())<<15)^rand())%(POWER_MODULUS/POWER_PRIME))+c;
+             unit_start=clock();
+             second_stage(1,&i,k,&R,&L,&table_size_pairs,&triplets,NULL);
+             t=(double) (clock()-unit_start)/CLOCKS_PER_SEC;
+             sum[c]+=t,sum2[c]+=t*t,n[c]++;
+             c=3-c;
+       }
+   }
+   printf("Sampling took %.1f sec.\n",(double) (clock()-start)/CLOCKS_PER_SEC);
+
+   // stratified estimate with normal 95% confidence bounds
+   total=0.0,total_var=0.0;
+   for(c=0;c<3;c++)  {
+       mean=sum[c]/n[c];
+       var=(sum2[c]-n[c]*mean*mean)/(n[c]-1);
+       if(var<0.0)  var=0.0;
+       total+=units[c]*mean;
+       total_var+=units[c]*units[c]*var/n[c];
+       if(c==0)  printf("first stage: %.0f units, sampled %ld of them, %.3f sec per unit on average\n",units[c],n[c],mean);
+       else      printf("second stage with k%%P==%ld: %.0f units, sampled %ld of them, %.6f sec per unit on average\n",c,units[c],n[c],mean);
+   }
+   low=(total-1.96*sqrt(total_var))/3600.0;
+   high=(total+1.96*sqrt(total_var))/3600.0;
+   if(low<0.0)  low=0.0;
+   printf("Estimated time: %.2f core-hours ( 95%% confidence: %.2f-%.2f core-hours )\n",total/3600.0,low,high);
+
+   memory=(double) table_size_L+table_size_R+2*table_size_triplets+2*POWER_MODULUS+2*p+2*Range;
+   memory*=sizeof(unsigned int);
+   printf("Estimated peak memory: %.1f MB\n",memory/1048576.0);
+   report_fill();
+
+   shards=(unsigned long int) (high/hours)+1;
+   if(shards>num_res)  shards=num_res;
+   printf("Suggested number of jobs: %ld ( at most %.2f hours for each )\n",shards,high/shards);
+   if(shards>PLAN_MAX_JOBS_LIST)  printf("Each job gets about %ld residues\n",num_res/shards);
+   else  {
+      for(j=0;j<shards;j++)  {
+          first=start_rem_p+j*num_res/shards;
+          last=start_rem_p+(j+1)*num_res/shards-1;
+          printf("job %ld: start_rem_p=%ld, end_rem_p=%ld\n",j+1,first,last);
+      }
+   }
+
+   return;
+}
+
+#if EXPONENT==6
+   static const unsigned long int known_solutions[][7]={{1117,770,1092,861,602,212,84}};  // a,b,c,d,e,f,g below BENCH_RANGE
+   #define NUM_KNOWN (sizeof(known_solutions)/sizeof(known_solutions[0]))
+#else
+   static const unsigned long int known_solutions[1][7]={{0}};  // there is no known solution for the other systems
+   #define NUM_KNOWN 0
+#endif
+   static unsigned long int known_found[NUM_KNOWN+1];  // the number of the searched residues where the known solution is found
+
+static void bench_solution(void* user, unsigned long int a, unsigned long int b, unsigned long int c,
+                    unsigned long int d, unsigned long int e, unsigned long int f, unsigned long int g)
+{
+// counts the known solution that is found, the order of the terms on a side doesn't matter. A solution is found
+// in each residue of the choices of e,f,g, so a known solution is printed only at the first time.
+   unsigned long int j,m,n,t,x[7];
+
+   x[0]=a,x[1]=b,x[2]=c,x[3]=d,x[4]=e,x[5]=f,x[6]=g;
+   for(m=0;m<7;m++)
+       for(n=m+1;n<((m<2)?2:7);n++)
+           if(x[n]>x[m])  t=x[m],x[m]=x[n],x[n]=t;
+   for(j=0;j<NUM_KNOWN;j++)  {
+       for(m=0;(m<7)&&(x[m]==known_solutions[j][m]);m++);
+       if(m==7)  break;
+   }
+   if(j<NUM_KNOWN)  known_found[j]++;
+   if((j==NUM_KNOWN)||(known_found[j]==1))
+      printf("Solution found! %ld" POW "+%ld" POW "=%ld" POW "+%ld" POW "+%ld" POW "+%ld" POW "+%ld" POW "\n",a,b,c,d,e,f,g);
+
+   return;
+}
+
+static unsigned long int bench_work(void)
+{
+// -bench: microbenchmarks of the parts of the search on fixed residues and k values with the tables of the
+// command line parameters, then a scaled-down search with Range=BENCH_RANGE of the residues of the known
+// solutions, these have to be found again. Returns 1 if a known solution is missed.
+   unsigned long int c,i,j,k,l,m,n,u,num,num_res,pairs,probes,checks,staged_size,merge;
+   unsigned long int res[4*NUM_KNOWN+1];
+   unsigned int *staged;
+   double t_gen,t_part,t_build,t_stage[2],t_check,seconds;
+   clock_t start;
+   struct rusage usage;
+   euler_context ctx;
+
+   printf("Microbenchmarks with Range=%ld, p=%ld, q=%ld, r=%ld\n",Range,p,q,r);
+   staged_size=table_size_triplets;
+   staged=(unsigned int*) (malloc) (staged_size*sizeof(unsigned int));
+   num=0,t_gen=0.0,t_part=0.0;
+   for(j=0;j<BENCH_RESIDUES;j++)  {
+       i=(j+1)*(p/(BENCH_RESIDUES+1));
+       start=clock();
+       n=generate_triplets(i,R,&staged,&staged_size);
+       t_gen+=(double) (clock()-start)/CLOCKS_PER_SEC;
+       grow_triplet_tables(i,n,&R,&triplets,&table_size_triplets);
+       start=clock();
+       partition_triplets(i,n,R,staged,triplets);
+       t_part+=(double) (clock()-start)/CLOCKS_PER_SEC;
+       num+=n;
+   }
+   free(staged);
+   if(t_gen<=0.0)  t_gen=1e-6;
+   if(t_part<=0.0)  t_part=1e-6;
+   printf("stage one generation: %ld triplets of %d residues in %.3f sec, %.0f triplets/sec\n",num,BENCH_RESIDUES,t_gen,num/t_gen);
+   printf("R build: %.3f sec, %.0f triplets/sec\n",t_part,num/t_part);
+
+   // R holds the last residue i, the same k values are built and then searched
+   // the second stage is timed with both join strategies, merge=0 is the hash join ( sliced if -slices is given )
+   merge=merge_join;
+   pairs=0,probes=0,t_build=0.0,t_stage[0]=0.0,t_stage[1]=0.0;
+   for(j=0;j<BENCH_K;j++)  {
+       k=POWER_PRIME*((j*7919)%(POWER_MODULUS/POWER_PRIME))+1+j%2;
+       start=clock();
+       build_L(k,&L,&table_size_pairs);
+       t_build+=(double) (clock()-start)/CLOCKS_PER_SEC;
+       pairs+=L[p+1];
+       for(l=0;l<p;l++)  {
+           u=(l>=i)?l-i:l+p-i;
+           probes+=(unsigned long int) (L[l+1]-L[l])*(L[u+1]-L[u]);
+       }
+       for(merge_join=0;merge_join<2;merge_join++)  {
+           start=clock();
+           second_stage(1,&i,k,&R,&L,&table_size_pairs,&triplets,NULL);
+           t_stage[merge_join]+=(double) (clock()-start)/CLOCKS_PER_SEC;
+       }
+   }
+   merge_join=merge;
+   if(t_build<=0.0)  t_build=1e-6;
+   printf("L build: %ld pairs of %d k values in %.3f sec, %.0f pairs/sec\n",pairs,BENCH_K,t_build,pairs/t_build);
+   // the second stage builds L again, so its time is subtracted
+   for(j=0;j<2;j++)  {
+       t_stage[j]-=t_build;
+       if(t_stage[j]<=0.0)  t_stage[j]=1e-6;
+   }
+   if(num_slices>1)  printf("duo join, hash in %ld slices: ",num_slices);
+   else              printf("duo join, hash: ");
+   printf("%ld probes in %.3f sec, %.0f probes/sec\n",probes,t_stage[0],probes/t_stage[0]);
+   printf("duo join, merge: %ld probes in %.3f sec, %.0f probes/sec ( %.2f times the speed of the hash join )\n",probes,t_stage[1],
+          probes/t_stage[1],t_stage[0]/t_stage[1]);
+   // a hit check joins the buckets of l and l-i again, L holds the last k
+   checks=0;
+   start=clock();
+   for(l=0;l<p;l+=p/BENCH_CHECKS+1)  check_hit(i,l,R,L,triplets,NULL),checks++;
+   t_check=(double) (clock()-start)/CLOCKS_PER_SEC;
+   if(t_check<=0.0)  t_check=1e-6;
+   printf("hit reconstruction: %ld checks in %.3f sec, %.0f checks/sec\n",checks,t_check,checks/t_check);
+   getrusage(RUSAGE_SELF,&usage);
+   printf("peak RSS: %.1f MB\n",usage.ru_maxrss/1024.0);
+
+   // the scaled-down search: p,q,r are chosen again for BENCH_RANGE
+   free_tables();
+   R=NULL;
+   q=0,r=0;
+   memset(&ctx,0,sizeof(ctx));
+   ctx.solution=bench_solution;
+   ctx.Range=BENCH_RANGE;
+   if(euler_init(&ctx))  return 1;
+   printf("Correctness check with Range=%ld, p=%ld, q=%ld, r=%ld\n",Range,p,q,r);
+   if(NUM_KNOWN==0)  {
+      printf("There is no known solution of this system below %d, the check is skipped.\n",BENCH_RANGE);
+      euler_free(&ctx);
+      return 0;
+   }
+   // the residues (e^n+f^n+g^n)%p for each choice of e,f,g from the terms of the right side divisible by P
+   num_res=0;
+   for(j=0;j<NUM_KNOWN;j++)  {
+       known_found[j]=0;
+       for(c=2;c<7;c++)
+           for(m=c+1;m<7;m++)
+               for(n=m+1;n<7;n++)  {
+                   if((known_solutions[j][c]%POWER_PRIME)||(known_solutions[j][m]%POWER_PRIME)||(known_solutions[j][n]%POWER_PRIME))  continue;
+                   i=(powmodn(known_solutions[j][c],p)+powmodn(known_solutions[j][m],p)+powmodn(known_solutions[j][n],p))%p;
+                   for(u=0;(u<num_res)&&(res[u]!=i);u++);
+                   if((u==num_res)&&(num_res<4*NUM_KNOWN+1))  res[num_res++]=i;
+               }
+   }
+   start=clock();
+   for(u=0;u<num_res;u++)  euler_search_residue(&ctx,res[u],0);
+   seconds=(double) (clock()-start)/CLOCKS_PER_SEC;
+   euler_free(&ctx);
+   num=0;
+   for(j=0;j<NUM_KNOWN;j++)  {
+       if(known_found[j]>0)  num++;
+       printf("The known solution %ld" POW "+%ld" POW "=... is found in %ld residues.\n",known_solutions[j][0],known_solutions[j][1],known_found[j]);
+   }
+   printf("Searched %ld residues in %.2f sec, found %ld of the %ld known solutions.\n",num_res,seconds,num,(unsigned long int) NUM_KNOWN);
+   getrusage(RUSAGE_SELF,&usage);
+   printf("peak RSS: %.1f MB\n",usage.ru_maxrss/1024.0);
+
+   return (num<NUM_KNOWN);
+}
+
+static unsigned long int is_finished(unsigned long int i)
+{
+   return (finished[(i-sched_start)>>3]>>((i-sched_start)&7))&1;
+}
+
+static void set_finished(unsigned long int i)
+{
+// the caller holds sched_lock
+   finished[(i-sched_start)>>3]|=1<<((i-sched_start)&7);
+   while((lowest_unfinished<=sched_end)&&is_finished(lowest_unfinished))  lowest_unfinished++;
+
+   return;
+}
+
+static unsigned long int get_progress(unsigned long int i)
+{
+// the k value where the residue i is continued, the caller holds sched_lock
+   unsigned long int j;
+
+   for(j=0;j<num_progress;j++)
+       if(progress_i[j]==i)  return progress_k[j];
+
+   return 0;
+}
+
+static void set_progress(unsigned long int i, unsigned long int k)
+{
+// the caller holds sched_lock
+   unsigned long int j;
+
+   for(j=0;j<num_progress;j++)
+       if(progress_i[j]==i)  {
+          progress_k[j]=k;
+          return;
+       }
+   if(num_progress==size_progress)  {
+      size_progress=2*size_progress+16;
+      progress_i=(unsigned long int*) (realloc) (progress_i,size_progress*sizeof(unsigned long int));
+      progress_k=(unsigned long int*) (realloc) (progress_k,size_progress*sizeof(unsigned long int));
+   }
+   progress_i[num_progress]=i,progress_k[num_progress]=k,num_progress++;
+
+   return;
+}
+
+static void save_work(void)
+{
+// The workfile is written to a temporary file and renamed, so a crash while saving leaves the previous one intact.
+// start_rem_p is the lowest unfinished residue and start_k is its position, done= is the bitmap of the finished
+// residues from start_rem_p ( a hex digit for 4 residues, the lowest bit is the lowest residue ),
+// progress= is the lowest unfinished k of an unfinished residue, so the residues can be finished in any order.
+   FILE* workfile;
+   unsigned long int i,j,last,u;
+
+   pthread_mutex_lock(&work_lock);
+   pthread_mutex_lock(&sched_lock);
+   workfile=fopen("euler_" SYSTEM "work.tmp","w");
+   if(workfile==NULL)  {
+      printf("Cannot write the workfile!\n");
+      pthread_mutex_unlock(&sched_lock);
+      pthread_mutex_unlock(&work_lock);
+      return;
+   }
+   fprintf(workfile,"// Please don't modify this file\n");
+   fprintf(workfile,"start_rem_p=%ld\n",lowest_unfinished);
+   fprintf(workfile,"end_rem_p=%ld\n",sched_end);
+   fprintf(workfile,"start_k=%ld\n",(lowest_unfinished<=sched_end)?get_progress(lowest_unfinished):0);
+   fprintf(workfile,"Range=%ld\n",Range);
+   fprintf(workfile,"q=%ld\n",q);
+   fprintf(workfile,"r=%ld\n",r);
+   last=lowest_unfinished;
+   for(i=lowest_unfinished;i<=sched_end;i++)
+       if(is_finished(i))  last=i+1;
+   fprintf(workfile,"done=");
+   for(i=lowest_unfinished;i<last;i+=4)  {
+       u=0;
+       for(j=0;(j<4)&&(i+j<=sched_end);j++)  u+=is_finished(i+j)<<j;
+       fprintf(workfile,"%lx",u);
+   }
+   fprintf(workfile,"\n");
+   for(j=0;j<num_progress;j++)
+       if((progress_i[j]>=lowest_unfinished)&&(progress_i[j]<=sched_end)&&(!is_finished(progress_i[j]))&&(progress_k[j]>0))
+          fprintf(workfile,"progress=%ld %ld\n",progress_i[j],progress_k[j]);
+   pthread_mutex_unlock(&sched_lock);
+   fflush(workfile);
+   fsync(fileno(workfile));
+   fclose(workfile);
+   rename("euler_" SYSTEM "work.tmp","euler_" SYSTEM "work.txt");
+   pthread_mutex_unlock(&work_lock);
+
+   return;
+}
+
+static void stop_handler(int sig)
+{
+   stop_request=1;
+}
+
+static void* checkpoint_timer(void* arg)
+{
+// the search loop only polls save_request and stop_request, the time is measured here.
+// If the search doesn't reach the next k value in STOP_TIMEOUT seconds after a signal
+// ( for example it is in the first stage ) then save the last known positions and exit.
+// A worker sends the heartbeats of its lease from here, and it gives the residue back instead of saving it.
+   unsigned int elapsed=0,stopping=0,beat=0;
+   unsigned long int lease;
+   char request[COORDINATOR_LINE],reply[COORDINATOR_LINE+1];
+
+   for(;;)  {
+       sleep(1);
+       elapsed++;
+       if(elapsed>=TIME_INTERVAL)  elapsed=0,save_request=1;
+       if(worker_active&&(++beat>=worker_heartbeat))  {
+          beat=0;
+          lease=coordinator_heartbeat(worker_address,&worker_unit,&worker_lease);
+          if(lease>0)  lost_lease=lease;
+       }
+       if(stop_request)  {
+          stopping++;
+          if(stopping>=STOP_TIMEOUT)  {
+             if(worker_address!=NULL)  {
+                if(worker_active)  {
+                   sprintf(request,"FAIL %ld %ld stopped by a signal",worker_unit,worker_lease);
+                   coordinator_request(worker_address,request,reply);
+                }
+             }
+             else  save_work();
+             // _exit() doesn't flush the files, the lock waits for a JSON record that is written now
+             if(stats_file!=NULL)  {
+                pthread_mutex_lock(&stats_lock);
+                fclose(stats_file);
+             }
+             printf("\nStopped by a signal, the work is saved\n");
+             fflush(stdout);
+             _exit(0);
+          }
+       }
+   }
+   return NULL;
+}
+
+static void* stage_two_worker(void* arg)
+{
+// one thread of the parallel second stage: takes the next chunk of k values until there is no more.
+// The k%P==1 and k%P==2 values differ a lot in cost, so the chunks are small and given out dynamically.
+   stage_two_thread* th=(stage_two_thread*) arg;
+   stage_two_job* job=th->job;
+   unsigned long int k,k0;
+
+   for(;;)  {
+       pthread_mutex_lock(&job->lock);
+       k0=job->next_k;
+       if((k0<POWER_MODULUS)&&(!stop_request))  job->next_k+=K_CHUNK,job->current[th->t]=k0;
+       else                              job->current[th->t]=POWER_MODULUS;
+       pthread_mutex_unlock(&job->lock);
+       if((k0>=POWER_MODULUS)||stop_request)  break;
+       for(k=k0;(k<k0+K_CHUNK)&&(k<POWER_MODULUS);k++)  {
+           if((k%POWER_PRIME==1)||(k%POWER_PRIME==2))  second_stage(job->num_res,job->i,k,job->R,&th->L,&th->L_size,job->triplets,
+                                                                      (stats_file!=NULL)?job->stats:NULL);
+       }
+   }
+
+   return NULL;
+}
+
+static void save_progress(stage_two_job* job)
+{
+// all k values below the saved one are done in the second stage of the residues of the job
+   unsigned long int b,num_res,t,k;
+   unsigned long int i[MAX_BATCH];
+
+   pthread_mutex_lock(&job->lock);
+   num_res=job->num_res;
+   for(b=0;b<num_res;b++)  i[b]=job->i[b];
+   k=job->next_k;
+   for(t=0;t<job->num_threads;t++)
+       if(job->current[t]<k)  k=job->current[t];
+   pthread_mutex_unlock(&job->lock);
+   pthread_mutex_lock(&sched_lock);
+   for(b=0;b<num_res;b++)  set_progress(i[b],k);
+   pthread_mutex_unlock(&sched_lock);
+
+   return;
+}
+
+static void parallel_second_stage(stage_two_job* job, unsigned int **L, unsigned long int *L_size)
+{
+// the second stage of the batch of the job with job->num_threads threads, they share the read-only R and triplets tables
+// and each of them has its own L table ( the first one uses *L, it is given back as it can be grown )
+   unsigned long int t;
+   pthread_t *threads;
+   stage_two_thread *th;
+
+   threads=(pthread_t*) (malloc) (job->num_threads*sizeof(pthread_t));
+   th=(stage_two_thread*) (malloc) (job->num_threads*sizeof(stage_two_thread));
+   for(t=0;t<job->num_threads;t++)  {
+       th[t].job=job,th[t].t=t;
+       th[t].L=*L,th[t].L_size=*L_size;
+       if(t>0)  th[t].L=(unsigned int*) (malloc) (table_size_L*sizeof(unsigned int)),th[t].L_size=table_size_pairs;
+       if(th[t].L==NULL)  {
+          printf("Not enough memory on this computer, sorry.\nExit.\n");
+          exit(1);
+       }
+   }
+   for(t=1;t<job->num_threads;t++)  pthread_create(&threads[t],NULL,stage_two_worker,&th[t]);
+   stage_two_worker(&th[0]);
+   for(t=1;t<job->num_threads;t++)  pthread_join(threads[t],NULL),free(th[t].L);
+   *L=th[0].L,*L_size=th[0].L_size;
+
+   free(threads);
+   free(th);
+
+   return;
+}
+
+static void* residue_worker(void* arg)
+{
+// one batch of residues at once in the parallel search, it takes the next batch until there is no more,
+// with its own R,L,triplets tables.
+// A batch is at most batch_size residues with the same position, so the residues of a stopped batch
+// are taken again together.
+   stage_two_job* job=(stage_two_job*) arg;
+   unsigned int *myL;
+   unsigned long int b,i[MAX_BATCH],k,num_res,myL_size;
+   time_t seconds;
+
+   myL=(unsigned int*) (malloc) (table_size_L*sizeof(unsigned int));
+   myL_size=table_size_pairs;
+   for(b=0;b<batch_size;b++)  {
+       job->R[b]=(unsigned int*) (malloc) (table_size_R*sizeof(unsigned int));
+       job->triplets[b]=(unsigned int*) (malloc) (table_size_triplets*sizeof(unsigned int));
+       job->size[b]=table_size_triplets;
+       if((myL==NULL)||(job->R[b]==NULL)||(job->triplets[b]==NULL))  {
+          printf("Not enough memory on this computer, sorry.\nExit.\n");
+          exit(1);
+       }
+   }
+
+   for(;;)  {
+       pthread_mutex_lock(&sched_lock);
+       num_res=0,k=0;
+       while(num_res<batch_size)  {
+          while((next_residue<=sched_end)&&is_finished(next_residue))  next_residue++;
+          if((next_residue>sched_end)||stop_request)  break;
+          if((num_res>0)&&(get_progress(next_residue)!=k))  break;
+          k=get_progress(next_residue);
+          i[num_res++]=next_residue++;
+       }
+       pthread_mutex_unlock(&sched_lock);
+       if(num_res==0)  break;
+
+       seconds=time(NULL);
+       for(b=0;b<num_res;b++)  {
+           first_stage(i[b],&job->R[b],&job->triplets[b],&job->size[b]);
+           if(stats_file!=NULL)  first_stage_stats(&job->stats[b],job->R[b],job->size[b]);
+       }
+       pthread_mutex_lock(&job->lock);
+       for(b=0;b<num_res;b++)  job->i[b]=i[b];
+       job->num_res=num_res;
+       job->next_k=k;
+       pthread_mutex_unlock(&job->lock);
+       parallel_second_stage(job,&myL,&myL_size);
+       if(stop_request)  break;
+
+       pthread_mutex_lock(&job->lock);
+       job->num_res=0;
+       pthread_mutex_unlock(&job->lock);
+       pthread_mutex_lock(&sched_lock);
+       for(b=0;b<num_res;b++)  {
+           set_finished(i[b]);
+           printf("Complete remainder=%ld. Time=%ld sec.\n",i[b],time(NULL)-seconds);
+       }
+       fflush(stdout);
+       pthread_mutex_unlock(&sched_lock);
+       // written after the unlock, write_stats() has its own lock, so the file doesn't block the scheduling of the other threads
+       if(stats_file!=NULL)
+          for(b=0;b<num_res;b++)  write_stats(i[b],&job->stats[b]);
+   }
+
+   for(b=0;b<batch_size;b++)  free(job->R[b]),free(job->triplets[b]);
+   free(myL);
+
+   return NULL;
+}
+
+static void parallel_search(unsigned long int start_rem_p, unsigned long int end_rem_p, unsigned long int threads, unsigned long int batch,
+                     double memory)
+{
+// search the residues start_rem_p..end_rem_p with threads threads in batches of batch residues. Each residue searched
+// at once needs its own R,triplets tables, so the number of concurrent batches and their size is limited by the memory
+// budget, the rest of the threads are used in the second stage of the batches ( they need only one more L table each ).
+// A batch shares the L table of each k, so building it is paid only once for the residues of the batch.
+// The finished residues and the positions are in the globals set up by main().
+   unsigned long int j,num,lowest,k,kthreads;
+   double shared,per_residue,per_thread;
+   pthread_t *workers;
+
+   shared=(double) (2*p+2*POWER_MODULUS+2*Range)*sizeof(unsigned int);
+   per_residue=(double) (table_size_R+2*table_size_triplets)*sizeof(unsigned int);  // with the staging of first_stage()
+   per_thread=(double) table_size_L*sizeof(unsigned int);
+   if(lcache!=NULL)  per_thread=0.0;  // the L tables are in the page cache, their own L isn't touched
+   if((num_slices>1)||merge_join)  per_thread+=(double) SLICE_PROBES*(2*sizeof(slice_probe)+sizeof(unsigned int));
+   if(batch>MAX_BATCH)  batch=MAX_BATCH;
+   if(batch>end_rem_p-start_rem_p+1)  batch=end_rem_p-start_rem_p+1;
+   num=threads;
+   if(num>(end_rem_p-start_rem_p+batch)/batch)  num=(end_rem_p-start_rem_p+batch)/batch;
+   while((num>1)&&(shared+num*batch*per_residue+threads*per_thread>memory))  num--;
+   while((batch>1)&&(shared+num*batch*per_residue+threads*per_thread>memory))  batch--;
+   if(shared+num*batch*per_residue+threads*per_thread>memory)
+      printf("The memory budget of %.0f MB is not enough, using at least %.0f MB\n",memory/1048576.0,(shared+per_residue+threads*per_thread)/1048576.0);
+   printf("Searching %ld batches of %ld residues at once with %ld threads, using about %.0f MB\n",num,batch,threads,
+          (shared+num*batch*per_residue+threads*per_thread)/1048576.0);
+   batch_size=batch;
+   // the jobs have their own tables, so the global ones are freed
+   free(R),free(L),free(triplets);
+   R=NULL,L=NULL,triplets=NULL;
+
+   workers=(pthread_t*) (malloc) (num*sizeof(pthread_t));
+   jobs=(stage_two_job*) (malloc) (num*sizeof(stage_two_job));
+   for(j=0;j<num;j++)  {
+       // the threads are shared out as evenly as possible
+       kthreads=threads/num+(j<threads%num);
+       jobs[j].num_res=0,jobs[j].next_k=POWER_MODULUS,jobs[j].num_threads=kthreads;
+       jobs[j].current=(unsigned long int*) (malloc) (kthreads*sizeof(unsigned long int));
+       for(k=0;k<kthreads;k++)  jobs[j].current[k]=POWER_MODULUS;
+       pthread_mutex_init(&jobs[j].lock,NULL);
+   }
+   for(j=0;j<num;j++)  pthread_create(&workers[j],NULL,residue_worker,&jobs[j]);
+
+   // the workers are polled here, so the checkpoint has only one writer
+   for(;;)  {
+       for(j=0;j<num;j++)  save_progress(&jobs[j]);
+       pthread_mutex_lock(&sched_lock);
+       lowest=lowest_unfinished;
+       pthread_mutex_unlock(&sched_lock);
+       if(lowest>end_rem_p)  break;
+       if(save_request||stop_request)  {
+          save_request=0;
+          save_work();
+          if(stop_request)  break;
+       }
+       sleep(1);
+   }
+
+   for(j=0;j<num;j++)  pthread_join(workers[j],NULL);
+   if(stop_request)  {
+      // the threads finished their chunks, so the saved positions can be only higher now
+      for(j=0;j<num;j++)  save_progress(&jobs[j]);
+      save_work();
+      pthread_mutex_lock(&sched_lock);
+      lowest=lowest_unfinished;
+      k=(lowest<=end_rem_p)?get_progress(lowest):0;
+      pthread_mutex_unlock(&sched_lock);
+      printf("\nStopped by a signal, the work is saved at remainder=%ld,k=%ld\n",lowest,k);
+      report_fill();
+      exit(0);
+   }
+
+   for(j=0;j<num;j++)  free(jobs[j].current),pthread_mutex_destroy(&jobs[j].lock);
+   free(jobs);
+   free(workers);
+
+   return;
+}
+
+static void worker_search(unsigned long int start_rem_p, unsigned long int end_rem_p)
+{
+// -worker: the residues start_rem_p..end_rem_p are leased from the coordinator one by one, see coordinator.h,
+// a residue is searched from k=0 and the coordinator keeps the finished ones, so the worker has no workfile.
+// Run one worker for each core, they can be on more computers.
+   char name[64],search[256],request[COORDINATOR_LINE],reply[COORDINATOR_LINE+1];
+   unsigned long int i,k,lease,heartbeat;
+   search_stats stats;
+   time_t seconds;
+
+   gethostname(name,sizeof(name));
+   name[sizeof(name)-1]=0;
+   sprintf(search,"euler" SYSTEM ",Range=%ld,q=%ld,r=%ld",Range,q,r);
+   while(!stop_request)  {
+      sprintf(request,"LEASE %s %ld %ld %s:%d",search,start_rem_p,end_rem_p,name,(int) getpid());
+      if(worker_request(worker_address,request,reply))  {
+         printf("The coordinator at %s is not reachable, exit.\n",worker_address);
+         return;
+      }
+      if(!strcmp(reply,"DONE"))  {
+         printf("All residues are finished.\n");
+         return;
+      }
+      if(!memcmp(reply,"WAIT ",5))  {
+         sleep(strtoul(reply+5,NULL,10));
+         continue;
+      }
+      if(sscanf(reply,"UNIT %lu %lu %lu",&i,&lease,&heartbeat)!=3)  {
+         printf("The coordinator refused the work: %s\n",reply);
+         return;
+      }
+      worker_unit=i,worker_lease=lease,worker_heartbeat=heartbeat,worker_solutions=0;
+      worker_active=1;
+      printf("Testing remainder=%ld\n",i);
+      seconds=time(NULL);
+      first_stage(i,&R,&triplets,&table_size_triplets);
+      if(stats_file!=NULL)  first_stage_stats(&stats,R,table_size_triplets);
+      for(k=0;(k<POWER_MODULUS)&&(!stop_request)&&(lost_lease!=lease);k++)
+          if((k%POWER_PRIME==1)||(k%POWER_PRIME==2))  second_stage(1,&i,k,&R,&L,&table_size_pairs,&triplets,(stats_file!=NULL)?&stats:NULL);
+      worker_active=0;
+      if(lost_lease==lease)  {
+         printf("The lease of remainder=%ld timed out, it is searched by an other worker.\n",i);
+         continue;
+      }
+      if(stop_request)  {
+         sprintf(request,"FAIL %ld %ld stopped by a signal",i,lease);
+         worker_request(worker_address,request,reply);
+         printf("\nStopped by a signal, remainder=%ld is given back to the coordinator\n",i);
+         return;
+      }
+      if(stats_file!=NULL)  write_stats(i,&stats);
+      sprintf(request,"RESULT %ld %ld %ld %ld",i,lease,(long int) (time(NULL)-seconds),worker_solutions);
+      worker_request(worker_address,request,reply);
+      printf("Complete remainder=%ld. Time=%ld sec.\n",i,(long int) (time(NULL)-seconds));
+   }
+
+   return;
+}
+
+static unsigned long int work_parameter(char *line, char *name, char *option, unsigned long int given, unsigned long int value)
+{
+// the value of the name= line of the work file, it is used instead of the value of option given on the command line
+   unsigned long int work;
+
+   work=strtoul(line+strlen(name),NULL,10);
+   if(given&&(work!=value))  printf("The work file has %s%ld, %s %ld of the command line is ignored\n",name,work,option,value);
+
+   return work;
+}
+
+int main (int argc, char *argv[])  {
+
+   unsigned long int start_rem_p=0;
+   unsigned long int end_rem_p=0;
+
+   unsigned long int start_k=0;
+
+   unsigned long int i,j,k,percent,update,threads,batch,plan,bench,end_given,range_given,q_given,r_given;
+   double memory,hours;
+
+   char *line,*line_end,*done,*lcache_name,*stats_name;
+   search_stats stats;
+   FILE* workfile;
+   pthread_t timer;
+
+   time_t seconds;
+
+   // euler [-range N] [-start i] [-end j] [-q Q] [-r R] [-fp F] [-threads N] [-batch N] [-memory MB] [-plan [hours]] [-lcache file]
+   //       [-bench] [-stats file] [-slices N] [-join hash|merge] [-worker address]
+   // -range: search a,b,c,d,e,f,g<N, -start,-end: the residues mod p to search ( default all of them ),
+   // -q,-r: the moduli of R and the fingerprints, default: chosen for F expected false matches for a residue.
+   // -threads N [-memory MB] searches N residues at once ( N=0 uses all cores ) if there is enough memory for them.
+   // -batch N: the second stage sweeps the k values for N residues at once ( at most MAX_BATCH ), with the same L tables.
+   // -plan [hours] gives only an estimate of the running time, hours is the wanted time of one job.
+   // -bench gives the speed of the parts of the search and checks that the known solutions are found with a small Range,
+   // its exit code is 1 if one is missed.
+   // -stats file: a JSON line is appended for each finished residue with the fill of the tables, the bucket sizes
+   // and the fingerprint matches, see write_stats().
+   // -lcache file: the L tables of all k are built once into this file ( if it doesn't exist ) and read from it,
+   // it is about 3.5 MB for each k ( 120 GB for n=6 with the default Range ), so put it on a fast disk.
+   // -slices N: the second stage probes R in N slices ( at most MAX_SLICES ), choose N so that a slice fits in the L2 cache,
+   // -bench shows whether it is faster on the computer.
+   // -join merge: the second stage sorts the probes by the q residue and merges them with R, -join hash ( the default )
+   // probes R at random, -bench times both of them.
+   // -worker address: lease the residues from the coordinator at address ( host:port or the path of a local socket ),
+   // see coordinator.c, -start and -end give the residues of the search as without it.
+   threads=1,batch=1,plan=0,bench=0,end_given=0,range_given=0,q_given=0,r_given=0,hours=24.0,lcache_name=NULL,stats_name=NULL;
+   memory=(double) MEMORY_PERCENT/100.0*sysconf(_SC_PHYS_PAGES)*sysconf(_SC_PAGESIZE);
+   for(j=1;j<argc;j++)  {
+       if((!strcmp(argv[j],"-threads"))&&(j+1<argc))  threads=strtoul(argv[++j],NULL,10);
+       else if((!strcmp(argv[j],"-batch"))&&(j+1<argc))  batch=strtoul(argv[++j],NULL,10);
+       else if((!strcmp(argv[j],"-memory"))&&(j+1<argc))  memory=1048576.0*atof(argv[++j]);
+       else if((!strcmp(argv[j],"-range"))&&(j+1<argc))  Range=strtoul(argv[++j],NULL,10),range_given=1;
+       else if((!strcmp(argv[j],"-start"))&&(j+1<argc))  start_rem_p=strtoul(argv[++j],NULL,10);
+       else if((!strcmp(argv[j],"-end"))&&(j+1<argc))  end_rem_p=strtoul(argv[++j],NULL,10),end_given=1;
+       else if((!strcmp(argv[j],"-q"))&&(j+1<argc))  q=strtoul(argv[++j],NULL,10),q_given=1;
+       else if((!strcmp(argv[j],"-r"))&&(j+1<argc))  r=strtoul(argv[++j],NULL,10),r_given=1;
+       else if((!strcmp(argv[j],"-fp"))&&(j+1<argc))  false_positives=atof(argv[++j]);
+       else if((!strcmp(argv[j],"-lcache"))&&(j+1<argc))  lcache_name=argv[++j];
+       else if((!strcmp(argv[j],"-stats"))&&(j+1<argc))  stats_name=argv[++j];
+       else if((!strcmp(argv[j],"-worker"))&&(j+1<argc))  worker_address=argv[++j];
+       else if((!strcmp(argv[j],"-slices"))&&(j+1<argc))  num_slices=strtoul(argv[++j],NULL,10);
+       else if((!strcmp(argv[j],"-join"))&&(j+1<argc)&&(!strcmp(argv[j+1],"hash")))  merge_join=0,j++;
+       else if((!strcmp(argv[j],"-join"))&&(j+1<argc)&&(!strcmp(argv[j+1],"merge")))  merge_join=1,j++;
+       else if(!strcmp(argv[j],"-bench"))  bench=1;
+       else if(!strcmp(argv[j],"-plan"))  {
+          plan=1;
+          if((j+1<argc)&&(argv[j+1][0]!='-'))  hours=atof(argv[++j]);
+       }
+       else  {
+          printf("Unknown parameter: %s\n",argv[j]);
+          return 1;
+       }
+   }
+   if(threads==0)  threads=sysconf(_SC_NPROCESSORS_ONLN);
+   if(num_slices==0)  num_slices=1;
+   if(num_slices>MAX_SLICES)  num_slices=MAX_SLICES;
+
+   // an unfinished work is continued with its own parameters, in the -plan, -bench and -worker modes it is ignored,
+   // the differing -end, -range, -q and -r values of the command line are shown and ignored
+   // the done= line has a hex digit for 4 residues
+   line=(char*) (malloc) (MAX_RANGE/4+256);
+   done=(char*) (calloc) (MAX_RANGE/4+256,sizeof(char));
+   workfile=NULL;
+   if((!plan)&&(!bench)&&(worker_address==NULL))  workfile=fopen("euler_" SYSTEM "work.txt","r");
+   if(workfile!=NULL)  {
+      while(fgets(line,MAX_RANGE/4+256,workfile)!=NULL)  {
+         if(!memcmp(line,"start_rem_p=",12))  start_rem_p=strtoul(line+12,NULL,10);
+         if(!memcmp(line,"end_rem_p=",10))    end_rem_p=work_parameter(line,"end_rem_p=","-end",end_given,end_rem_p),end_given=1;
+         if(!memcmp(line,"start_k=",8))       start_k=strtoul(line+8,NULL,10);
+         if(!memcmp(line,"Range=",6))         Range=work_parameter(line,"Range=","-range",range_given,Range);
+         if(!memcmp(line,"q=",2))             q=work_parameter(line,"q=","-q",q_given,q);
+         if(!memcmp(line,"r=",2))             r=work_parameter(line,"r=","-r",r_given,r);
+         if(!memcmp(line,"done=",5))          strcpy(done,line+5);
+         if(!memcmp(line,"progress=",9))  {
+            i=strtoul(line+9,&line_end,10);
+            set_progress(i,strtoul(line_end,NULL,10));
+         }
+      }
+      fclose(workfile);
+      printf("Continue the work from remainder=%ld,k=%ld with Range=%ld,q=%ld,r=%ld of the work file\n",start_rem_p,start_k,Range,q,r);
+   }
+
+   if(choose_parameters())  return 1;
+   if(!end_given)  end_rem_p=p-1;
+   if((start_rem_p>end_rem_p)||(end_rem_p>=p))  {
+      printf("Bad residues, it should be 0<=start<=end<p=%ld\n",p);
+      return 1;
+   }
+   if((q<2)||(r<2)||(!is_prime(q))||(!is_prime(r)))  printf("Warning: q and r should be primes\n");
+   if(merge_join)  printf("The second stage uses the merge join\n");
+   else if(num_slices>1)  printf("R is probed in %ld slices of about %.2f MB\n",num_slices,(double) table_size_R*sizeof(unsigned int)/num_slices/1048576.0);
+
+   build_tables();
+
+   if(bench)  {
+      j=bench_work();
+      free(line);
+      free(done);
+      return j;
+   }
+
+   // in the -plan mode the cache is used only if it is already built
+   if(lcache_name!=NULL)  {
+      if(access(lcache_name,F_OK)&&(!plan))  {
+         if(build_lcache(lcache_name))  return 1;
+      }
+      if(open_lcache(lcache_name)&&(!plan))  return 1;
+   }
+
+   if(plan)  {
+      plan_work(start_rem_p,end_rem_p,hours);
+      close_lcache();
+      free_tables();
+      return 0;
+   }
+
+   // the residues of the job with the finished ones from the workfile
+   finished=(unsigned char*) (calloc) ((end_rem_p-start_rem_p)/8+1,sizeof(unsigned char));
+   sched_start=start_rem_p,sched_end=end_rem_p;
+   next_residue=start_rem_p,lowest_unfinished=start_rem_p;
+   if(start_k>0)  set_progress(start_rem_p,start_k);
+   for(j=0;isxdigit(done[j]);j++)  {
+       k=(done[j]<='9')?done[j]-'0':(done[j]|32)-'a'+10;
+       for(i=start_rem_p+4*j;i<start_rem_p+4*j+4;i++)
+           if(((k>>(i-start_rem_p-4*j))&1)&&(i<=end_rem_p))  set_finished(i);
+   }
+   free(line);
+   free(done);
+   if(stats_name!=NULL)  {
+      stats_file=fopen(stats_name,"a");
+      if(stats_file==NULL)  {
+         printf("Cannot write the statistics file %s\n",stats_name);
+         return 1;
+      }
+   }
+   signal(SIGTERM,stop_handler);
+   signal(SIGINT,stop_handler);
+   pthread_create(&timer,NULL,checkpoint_timer,NULL);
+
+   if(worker_address!=NULL)  {
+      // the coordinator keeps the work, -threads and -batch are ignored
+      worker_search(start_rem_p,end_rem_p);
+      report_fill();
+      if(stats_file!=NULL)  fclose(stats_file);
+      close_lcache();
+      free_tables();
+      free(finished);
+      return 0;
+   }
+   if(batch==0)  batch=1;
+   if((threads>1)||(batch>1))  parallel_search(start_rem_p,end_rem_p,threads,batch,memory);
+   else {
    for(i=start_rem_p;i<=end_rem_p;i++)  {
-   // e^6+f^6+g^6==i mod p where e<=f<=g, 7|e,f,g and at least one of them is even
-   // and at least one of them is divisible by 3
-   // if e=0 then f>0
+   if(is_finished(i))  continue;
+   start_k=get_progress(i);
    printf("Testing remainder=%ld\n",i);
    printf("First stage.\n");
    seconds=time(NULL);
    update=0;
-   nextpos=2*q;
-       for(j=0;j<2*q;j+=2)  R[j]=0;
-       for(e=0;e<Range;e+=7)  {
-           if(e==0) start_f=7;
-           else     start_f=e;
-           pre_p=remp[e];
-           pre_q=remq[e];
-           pre_r=remr[e];
-           for(f=start_f;f<Range;f+=7)  {
-               u=pre_p+remp[f];
-               if(u>=p)  u-=p;
-               if(u<=i)  u=i-u;
-               else      u=i+p-u;
-               temp[0]=Inversep[u],temp[1]=p-temp[0];
-               for(h=0;h<=1;h++)  {
-               g=temp[h];
-               if((g>=f)&&((g%7)==0)&&((e&1)+(f&1)+(g&1)<3)&&((e%3==0)||(f%3==0)||(g%3==0))&&(g<Range))  {
-                     pos=pre_q+remq[f]+remq[g];
-                     if(pos>=q)  pos-=q;
-                     if(pos>=q)  pos-=q;
-                     pos<<=1;
-                     w=pre_r+remr[f]+remr[g];
-                     if(w>=r)  w-=r;
-                     if(w>=r)  w-=r;
-                     w++;
-                     if(R[pos]==0)  {
-                        R[pos]=w;
-                        R[pos+1]=0;
-                        pos+=pos>>1;
-                        triplets[pos]=e;
-                        triplets[pos+1]=f;
-                        triplets[pos+2]=g;
-                     }
-                     else {
-                        while(R[pos+1]>0)  pos=R[pos+1];
-                        R[pos+1]=nextpos;
-                        R[nextpos]=w;
-                        R[nextpos+1]=0;
-                        pos=nextpos+(nextpos>>1);
-                        triplets[pos]=e;
-                        triplets[pos+1]=f;
-                        triplets[pos+2]=g;
-                        nextpos+=2;
-                     }
-                }
-                }
-             }
-          }
+   first_stage(i,&R,&triplets,&table_size_triplets);
+   if(stats_file!=NULL)  first_stage_stats(&stats,R,table_size_triplets);
     // finished the setup for right side
     printf("Complete the first stage. Time=%ld sec.\n",time(NULL)-seconds);
     seconds=time(NULL);
     printf("Second stage.\n");
-          for(k=0;k<power7;k++)  {// a^6+b^6==k mod 117649
-              if((k%7==1)||(k%7==2))  {
-                  percent=(int) (double) 100.0*k/power7;
-                  if(percent>update) update=percent,printf("    %ld percentage of the stage is complete. [ %ld sec. ]\r\r",update,time(NULL)-seconds),fflush(stdout);
-                  for(l=0;l<4*p;l+=4)  L[l]=0;
-                  nextpos=4*p;
-                  if(k%7==1)  {
-                     for(l=k;l<=k+5;l++)  {
-                         a=Inversepower7[l];
-                         pre_p=remp[a];
-                         pre_q=remq[a];
-                         pre_r=remr[a];
-                         for(b=0;b<Range;b+=7)  {
-                             pos=pre_p+remp[b];
-                             if(pos>=p)  pos-=p;
-                             pos<<=2;
-                             s=pre_q+remq[b];
-                             if(s>=q) s-=q;
-                             w=pre_r+remr[b];
-                             if(w>=r)  w-=r;
-                             w++;
-                             if(L[pos]==0)  {
-                                L[pos]=w;
-                                L[pos+1]=s;
-                                L[pos+2]=0;
-                             }
-                             else {
-                                if(L[pos+2]==0)  L[pos+2]=nextpos;
-                                else             L[L[pos+3]+2]=nextpos;
-                                L[pos+3]=nextpos;
-                                L[nextpos]=w;
-                                L[nextpos+1]=s;
-                                L[nextpos+2]=0;
-                                nextpos+=3;
-                             }
-                          }
-                      }
-                   }
-                   else {
-                      for(l=1;l<7;l++)  {
-                           for(a=l;a<Range;a+=7)  {
-                               st=rempower7[a];
-                               if(k>=st)  st=k-st;
-                               else       st=k+power7-st;
-                               pre_p=remp[a];
-                               pre_q=remq[a];
-                               pre_r=remr[a];
-                               for(m=st;m<=st+5;m++)  {
-                                   b=Inversepower7[m];
-                                   if(a>=b)  {  // symmetric rule
-                                      pos=pre_p+remp[b];
-                                      if(pos>=p) pos-=p;
-                                      pos<<=2;
-                                      s=pre_q+remq[b];
-                                      if(s>=q) s-=q;
-                                      w=pre_r+remr[b];
-                                      if(w>=r) w-=r;
-                                      w++;
-                                      if(L[pos]==0)  {
-                                         L[pos]=w;
-                                         L[pos+1]=s;
-                                         L[pos+2]=0;
-                                      }
-                                      else {
-                                           if(L[pos+2]==0) L[pos+2]=nextpos;
-                                           else            L[L[pos+3]+2]=nextpos;
-                                           L[pos+3]=nextpos;
-                                           L[nextpos]=w;
-                                           L[nextpos+1]=s;
-                                           L[nextpos+2]=0;
-                                           nextpos+=3;
-                                      }
-                                   }
-                                }
-                             }
-                        }
+          for(k=start_k;k<POWER_MODULUS;k++)  {// a^n+b^n==k mod POWER_MODULUS
+              if((k%POWER_PRIME==1)||(k%POWER_PRIME==2))  {
+                  pthread_mutex_lock(&sched_lock);
+                  set_progress(i,k);
+                  pthread_mutex_unlock(&sched_lock);
+                  if(save_request||stop_request)  {
+                     save_request=0;
+                     save_work();
+                     if(stop_request)  {
+                        printf("\nStopped by a signal, the work is saved at remainder=%ld,k=%ld\n",i,k);
+                        report_fill();
+                        exit(0);
                      }
-                     for(l=0;l<p;l++)  {  // a^6+b^6==l mod p, from this c^6+d^6==l-i mod p
-                     // positions in duo array:
-                     // (a^6+b^6)%r+1=duo[4*h]
-                     // (a^6+b^6)%q=duo[4*h+1]
-                     // (c^6+d^6)%r+1=duo[4*h+2]
-                     // (c^6+d^6)%q=duo[4*h+3]
-                         num=0,num2=2,test=0;
-                         pos=l<<2;
-                         if(L[pos]>0)  {
-                               duo[num]=L[pos];
-                               duo[num+1]=L[pos+1];
-                               num+=4;
-                               while(L[pos+2]>0)  {
-                                     pos=L[pos+2];
-                                     duo[num]=L[pos];
-                                     duo[num+1]=L[pos+1];
-                                     num+=4;
-                               }
-                          }
-                          if(l>=i)  u=l-i;
-                          else      u=l+p-i;
-                          pos=u<<2;
-                          if(L[pos]>0)  {
-                               duo[num2]=L[pos];
-                               duo[num2+1]=L[pos+1];
-                               num2+=4;
-                               while(L[pos+2]>0)  {
-                                     pos=L[pos+2];
-                                     duo[num2]=L[pos];
-                                     duo[num2+1]=L[pos+1];
-                                     num2+=4;
-                               }
-                           }
-                           for(m=0;m<num;m+=4)  {
-                               for(n=2;n<num2;n+=4)  {
-                                   w3=duo[m+1]-duo[n+1];
-                                   if(w3<0)  w3+=q;
-                                   pos=w3<<1;
-                                   if(R[pos]>0)  {
-                                      w2=duo[m]-duo[n];
-                                      if(w2<0)  w2+=r;
-                                      w2++;
-                                      if(R[pos]==w2)  test=1;
-                                      while(R[pos+1]>0)  {
-                                            pos=R[pos+1];
-                                            if(R[pos]==w2)  test=1;
-                                      }
-                                   }
-                                }
-                           }
-                        if(test)  {
-                             // checking routine, this happens very rarely
-                             // computation of the unsaved a,b,c,d values
-                             numb[0]=0,numb[1]=0;
-                             A[0]=l,A[1]=p+l-i;
-                             if(A[1]>=p)  A[1]-=p;
-                             // we overwrite the duo array
-                             // positions in duo array:
-                             // a=duo[4*h]
-                             // b=duo[4*h+1]
-                             // c=duo[4*h+2]
-                             // d=duo[4*h+3]
-                             for(n=0;n<=1;n++)  {
-                                 for(a=0;a<Range;a++)  {
-                                     u=remp[a];
-                                     if(A[n]>=u)  u=A[n]-u;
-                                     else         u=A[n]+p-u;
-                                     temp[0]=Inversep[u],temp[1]=p-temp[0];
-                                     for(m=0;m<=1;m++)  {
-                                         b=temp[m];
-                                         if((a>=b)&&(b<Range))  {
-                                            u=rempower7[a]+rempower7[b];
-                                            if(u>=power7) u-=power7;
-                                            if(u==k)  {
-                                                duo[4*numb[n]+2*n]=a;
-                                                duo[4*numb[n]+2*n+1]=b;
-                                                numb[n]++;
-                                            }
-                                         }
-                                     }
-                                 }
-                             }
-                             for(m=0;m<numb[0];m++)  {
-                                 for(n=0;n<numb[1];n++)  {
-                                     a=duo[4*m];
-                                     b=duo[4*m+1];
-                                     c=duo[4*n+2];
-                                     d=duo[4*n+3];
-                                     w2=(remq[a]+remq[b])%q;
-                                     w2-=(remq[c]+remq[d])%q;
-                                     if(w2<0) w2+=q;
-                                     pos=w2<<1;
-                                     if(R[pos]>0)  {
-                                        s=(pos>>1)+pos;
-                                        e=triplets[s];
-                                        f=triplets[s+1];
-                                        g=triplets[s+2];
-                                        test=1;
-                                        for(np=0;np<5;np++)  {
-                                            prm=primes[np];
-                                            w2=(powmod6(a,prm)+powmod6(b,prm))%prm;
-                                            w2-=(powmod6(c,prm)+powmod6(d,prm)+powmod6(e,prm)+powmod6(f,prm)+powmod6(g,prm))%prm;
-                                            if(w2<0) w2+=prm;
-                                            if(w2!=0) test=0;
-                                        }
-                                        if(test)  {
-                                           printf("Solution found! %ld^6+%ld^6=%ld^6+%ld^6+%ld^6+%ld^6+%ld^6                \n",a,b,c,d,e,f,g);
-                                           FILE* out;
-                                           out=fopen("euler_(6,2,5).txt","a+");
-                                           fprintf(out,"Solution found! %ld^6+%ld^6=%ld^6+%ld^6+%ld^6+%ld^6+%ld^6\n",a,b,c,d,e,f,g);
-                                           fclose(out);
-                                        }
-                                        while(R[pos+1]>0)  {
-                                              pos=R[pos+1];
-                                              s=(pos>>1)+pos;
-                                              e=triplets[s];
-                                              f=triplets[s+1];
-                                              g=triplets[s+2];
-                                              test=1;
-                                              for(np=0;np<5;np++)  {
-                                                  prm=primes[np];
-                                                  w2=(powmod6(a,prm)+powmod6(b,prm))%prm;
-                                                  w2-=(powmod6(c,prm)+powmod6(d,prm)+powmod6(e,prm)+powmod6(f,prm)+powmod6(g,prm))%prm;
-                                                  if(w2<0) w2+=prm;
-                                                  if(w2!=0) test=0;
-                                              }
-                                              if(test)  {
-                                                 printf("Solution found! %ld^6+%ld^6=%ld^6+%ld^6+%ld^6+%ld^6+%ld^6                \n",a,b,c,d,e,f,g);
-                                                 FILE* out;
-                                                 out=fopen("euler_(6,2,5).txt","a+");
-                                                 fprintf(out,"Solution found! %ld^6+%ld^6=%ld^6+%ld^6+%ld^6+%ld^6+%ld^6\n",a,b,c,d,e,f,g);
-                                                 fclose(out);
-                                              }
-                                         }
-                                     }
-                                  }
-                              }
-                           }
-                       }
                   }
-            }
+                  percent=(int) (double) 100.0*k/POWER_MODULUS;
+                  if(percent>update) update=percent,printf("    %ld percentage of the stage is complete. [ %ld sec. ]\r\r",update,time(NULL)-seconds),fflush(stdout);
+                  second_stage(1,&i,k,&R,&L,&table_size_pairs,&triplets,(stats_file!=NULL)?&stats:NULL);
+              }
+          }
     // finished the second stage
     printf("Complete the second stage. Time=%ld sec.                \n",time(NULL)-seconds);
+    pthread_mutex_lock(&sched_lock);
+    set_finished(i);
+    pthread_mutex_unlock(&sched_lock);
+    if(stats_file!=NULL)  write_stats(i,&stats);
+    if(i<end_rem_p)  save_work();
     }
+   }
 
-    free(remp);
-    free(Inversep);
-    free(R);
-    free(L);
-    free(remq);
-    free(remr);
-    free(rempower7);
-    free(Inversepower7);
-    free(triplets);
+    remove("euler_" SYSTEM "work.txt");
+    report_fill();
+    if(stats_file!=NULL)  fclose(stats_file);
+    close_lcache();
+    free_tables();
+    free(finished);
+    free(progress_i);
+    free(progress_k);
 
    return 0;
 }
+#endif
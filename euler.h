@@ -0,0 +1,60 @@
+// Library interface of euler.c: compile euler.c with -DEULER_LIBRARY to leave out main() and the other parts of the
+// program ( the workfile, the timer, the threads and the worker ) and call these functions from your own driver.
+// Only these functions are external, so it can be linked with euler413.c into one driver, see library_test.c.
+// The tables are static in euler.c, so there can be only one context at a time in a process,
+// but they are kept between the calls: the first stage is built only once for each residue
+// if the driver searches the k values of a residue one after the other.
+
+#ifndef EULER_H
+#define EULER_H
+
+// The system is a^n+b^n=c^n+d^n+e^n+f^n+g^n with n=EXPONENT, compile euler.c and the driver with the same
+// -DEXPONENT=n -DPOWER_PRIME=P -DPOWER_EXPONENT=E to search an other one than Euler(6,2,5).
+// P is a prime with P>5, (P-1)|n and P doesn't divide n, so x^n mod P is 0 or 1: then e,f,g are divisible by P and the
+// second stage runs over a^n+b^n==k mod P^E with k%P==1 or 2, E<=n.
+#ifndef EXPONENT
+#define EXPONENT 6
+#endif
+#ifndef POWER_PRIME
+#define POWER_PRIME 7
+#endif
+#ifndef POWER_EXPONENT
+#define POWER_EXPONENT 6
+#endif
+#define POWER_MODULUS ((unsigned long int) POWER_PRIME*(POWER_EXPONENT>1?POWER_PRIME:1)*(POWER_EXPONENT>2?POWER_PRIME:1)*\
+                       (POWER_EXPONENT>3?POWER_PRIME:1)*(POWER_EXPONENT>4?POWER_PRIME:1)*(POWER_EXPONENT>5?POWER_PRIME:1)*\
+                       (POWER_EXPONENT>6?POWER_PRIME:1)*(POWER_EXPONENT>7?POWER_PRIME:1))
+
+#if (EXPONENT%2)||(POWER_PRIME<7)||(EXPONENT%(POWER_PRIME-1))||(EXPONENT%POWER_PRIME==0)||(POWER_EXPONENT<1)||\
+    (POWER_EXPONENT>EXPONENT)||(POWER_EXPONENT>8)
+#error "Bad system: EXPONENT should be even, POWER_PRIME>5 with (POWER_PRIME-1)|EXPONENT, POWER_PRIME doesn't divide EXPONENT and 0<POWER_EXPONENT<=EXPONENT,8"
+#endif
+
+typedef struct  {
+   // called for each solution a^n+b^n=c^n+d^n+e^n+f^n+g^n.
+   // If it is NULL then the solution is printed and appended to euler_(n,2,5).txt
+   void (*solution)(void* user, unsigned long int a, unsigned long int b, unsigned long int c,
+                    unsigned long int d, unsigned long int e, unsigned long int f, unsigned long int g);
+   // called after each k value of euler_search_residue(), it can be NULL
+   void (*progress)(void* user, unsigned long int i, unsigned long int k);
+   void* user;  // passed to the callbacks
+   unsigned long int Range;  // search a,b,c,d,e,f,g<Range, 0 for the default POWER_MODULUS ( 117649 for n=6 )
+   unsigned long int p;  // set by euler_init(), the residues of the units are 0<=i<p
+} euler_context;
+
+// chooses p,q,r for the Range of ctx and builds the tables, returns 0 on success and 1 for a bad Range
+int euler_init(euler_context* ctx);
+
+// searches one (i,k) unit: the residue i mod p ( p=117659 for the default Range of n=6 ) and k<POWER_MODULUS
+// with k%POWER_PRIME==1 or 2,
+// the first stage is rebuilt only if i is different from the previous unit.
+// Returns 0 on success and 1 for a bad unit.
+int euler_search_unit(euler_context* ctx, unsigned long int i, unsigned long int k);
+
+// searches the k values start_k<=k<POWER_MODULUS of the residue i, start_k=0 is the whole residue
+int euler_search_residue(euler_context* ctx, unsigned long int i, unsigned long int start_k);
+
+// frees the tables, after this euler_init() builds them again
+void euler_free(euler_context* ctx);
+
+#endif
@@ -12,38 +12,76 @@
 // Modified to use a save file
 // Modified to use less memory by a factor of 3.75
 // Modified to use less memory and some gain in speed.  // Using 50MB Ram for 2 billion
+// Modified to filter the b values with AVX2/AVX-512 if the compiler targets them ( for example with -march=native )
+// Modified to save the work and stop at SIGTERM/SIGINT, compile with -lm -lpthread
+// Modified to be usable also as a library, see euler413.h
+// Modified to lease the a0 values from a coordinator, see coordinator.c: euler413 -worker address R R0 y|n
 //
 
 #include <stdio.h>
 #include <stdlib.h>
 #include <math.h>
+#include <string.h>
 #include <time.h>
+#include <signal.h>
+#include <pthread.h>
+#include <unistd.h>
+#include "euler413.h"
+#include "coordinator.h"
+#if defined(__AVX512F__)||defined(__AVX2__)
+#include <immintrin.h>
+#endif
 
 #define TIME_INTERVAL 600  // 600 seconds (update interval)
+#define STOP_TIMEOUT 20  // after a signal exit in at most this many seconds even if the unit isn't finished
+#define PLAN_TIME 60  // in the -plan mode sample units for at least this many seconds
+#define PLAN_MIN_SAMPLES 20  // and at least this many units of each type
+#define PLAN_MAX_JOBS_LIST 64  // list the suggested jobs only if there are at most this many
 
-   unsigned int table_size=262144;  // it is enough for Range<2 billion
-   unsigned int Range;  // this must be a multiple of 625*16384=10240000
+   static unsigned int table_size=262144;  // it is enough for Range<2 billion
+   static unsigned int Range;  // this must be a multiple of 625*16384=10240000
                               // search up to a<Range
+   static unsigned int start_Range;  // also a multiple of 10240000, search only start_Range<=a<Range
+                              // so a finished search up to start_Range can be extended
 
-   unsigned char complete_search;  // if it is 0 then we're searching only for special solutions
+   static unsigned char complete_search;  // if it is 0 then we're searching only for special solutions
                                     // , where two numbers of b,c,d are divisible by 40
                                     // this is much faster!
                                     // if it is positive then do complete search up to Range
                                       
-   unsigned int* R;
-   unsigned int* L;
-   unsigned int* temp;
-
-   FILE* out;
-
-unsigned int powmod4(unsigned int a, unsigned int p)
+   static unsigned int* R;
+   static unsigned int* L;
+   static unsigned int* temp;
+   static unsigned int* Table=NULL;  // bitmap of the admissible odd numbers up to 2*Range
+   static unsigned int* isprime=NULL;
+   static unsigned int E=0;  // isprime is computed up to E=2+sqrt(2*Range)
+   static unsigned int rem625[625],rem3125[3125],Inverserem625[625];
+   static unsigned int step_ab=625*16384;  // a and b are fixed modulo 625*16384 in one search unit
+
+   static FILE* out;
+   static euler413_context* context=NULL;  // set by euler413_init(), NULL in the program
+
+#ifndef EULER413_LIBRARY
+   // only the program: the workfile, the timer and the worker
+   static volatile sig_atomic_t stop_request=0;  // set by SIGTERM/SIGINT, the search stops before the next unit
+   static volatile sig_atomic_t save_request=0;  // set by the timer thread in every TIME_INTERVAL seconds
+   static volatile unsigned int work_a0,work_type,work_b0;  // the unit that is searched now
+   static unsigned int work_R_parameter,work_end_a0;
+   static pthread_mutex_t work_lock=PTHREAD_MUTEX_INITIALIZER;
+   static char *worker_address=NULL;  // -worker: the address of the coordinator, NULL if the a0 values aren't leased from one
+   static unsigned long int worker_unit,worker_lease,worker_heartbeat,worker_solutions;  // the leased unit, a0=8*worker_unit+1
+   static volatile sig_atomic_t worker_active=0;  // a unit is leased and searched now
+   static volatile unsigned long int lost_lease=0;  // set by the timer thread to the lease if the coordinator gave its unit to an other worker
+#endif
+
+static unsigned int powmod4(unsigned int a, unsigned int p)
 {
   unsigned long long int h=a,K=(h*h)%p;
   
   return (K*K)%p;
 }
 
-unsigned int powmod(unsigned int a, unsigned int pow, unsigned int p)
+static unsigned int powmod(unsigned int a, unsigned int pow, unsigned int p)
 {
 // return by a^pow modulo p
   unsigned long long int result=1,H=a;
@@ -66,7 +104,7 @@ static unsigned int Bits[] = {
                          0x01000000,0x02000000,0x04000000,0x08000000,
                          0x10000000,0x20000000,0x40000000,0x80000000};
 
-unsigned int single_modinv (unsigned int a, unsigned int modulus)
+static unsigned int single_modinv (unsigned int a, unsigned int modulus)
 { /* start of single_modinv */
 
   unsigned int ps1, ps2, dividend, divisor, rem, q, t;
@@ -135,7 +173,7 @@ unsigned int single_modinv (unsigned int a, unsigned int modulus)
     return (modulus - ps1);
 } /* end of single_modinv from Mersenneforum.org*/
 
-unsigned int gcd(unsigned int a, unsigned int b)
+static unsigned int gcd(unsigned int a, unsigned int b)
 // return by gcd of a and b
 {// fast but speed isn't important for the program.
    unsigned int c;
@@ -409,18 +447,20 @@ static unsigned int ispowerrem137[2*137]={
 0 ,1 ,0 ,1 ,1 ,1 ,0 ,0 ,0 ,0 ,0 ,0 ,0 ,0 ,0 ,
 1 ,0 ,0 ,1};
 
-unsigned int X[15][137],sizes[2];
-unsigned int R7,R13,R17,R29,R37,R41,R53,R61,R73,R89,R97,R101,R109,R113,R137;
-unsigned int np=0,*smallprimes; // all odd primes up to sqrt(2*Range) that are not congurent by 1 mod 8
-unsigned int A7[8],A13[14],A17[18],A29[30],A37[38],A41[42],A53[54],A61[62],A73[74],A89[90],A97[98],A101[102],A109[110],A113[114],A137[138];
+static unsigned int X[15][137],sizes[2];
+static unsigned int R7,R13,R17,R29,R37,R41,R53,R61,R73,R89,R97,R101,R109,R113,R137;
+static unsigned int np=0,*smallprimes; // all odd primes up to sqrt(2*Range) that are not congurent by 1 mod 8
+static unsigned int A7[8],A13[14],A17[18],A29[30],A37[38],A41[42],A53[54],A61[62],A73[74],A89[90],A97[98],A101[102],A109[110],A113[114],A137[138];
 static unsigned int modprimes[11]={7,13,17,29,37,41,53,61,73,89,97};
 static unsigned int largeprimes[5]={1000000007,1000000009,1000000021,1000000033,1000000087};
 
 static unsigned int good13rem[13]={1,1,1,1,1,1,1,0,0,1,1,0,1};
 static unsigned int good29rem[29]={1,1,1,1,0,0,0,1,1,0,1,1,1,0,1,1,1,1,1,1,1,1,0,1,1,1,1,1,0};
-unsigned int Inverserem[4][3125];
-unsigned int *count17,*count29,*count481,*specialcount29,*specialcount481;
-unsigned int **multipliers17,**multipliers29,**multipliers481,**specialmultipliers29,**specialmultipliers481;
+static unsigned int goodrem3125[10]={1,1,1,0,0,1,1,1,0,0};  // indexed by (3125+a^4-b^4 mod 3125)/625
+static unsigned int inv_16384_625=14;  // it is modinv(16384,625)
+static unsigned int Inverserem[4][3125];
+static unsigned int *count17,*count29,*count481,*specialcount29,*specialcount481;
+static unsigned int **multipliers17,**multipliers29,**multipliers481,**specialmultipliers29,**specialmultipliers481;
 
 static unsigned int factors[4]={1,5,3,2};
 static unsigned int multiplier[4]={1,3125,243,256};
@@ -430,7 +470,7 @@ static unsigned int num_cases2[4]={1,2,2,2};
 static unsigned int rem_mult_d[4][2];
 
 
-void finalcheck(unsigned int a, unsigned int b, unsigned int c, unsigned int d)
+static void finalcheck(unsigned int a, unsigned int b, unsigned int c, unsigned int d)
 {
     unsigned int i,p,u,GCD;
 
@@ -440,8 +480,12 @@ void finalcheck(unsigned int a, unsigned int b, unsigned int c, unsigned int d)
         if(u) return;
     }
 //  print also (primitive) if it is a primitive solution so if gcd(a,b,c,d)=1 is true.
-    printf("Solution found! %u^4=%u^4+%u^4+%u^4",a,b,c,d);
     GCD=gcd(a,gcd(b,gcd(c,d)));
+    if((context!=NULL)&&(context->solution!=NULL))  {
+       context->solution(context->user,a,b,c,d,GCD==1);
+       return;
+    }
+    printf("Solution found! %u^4=%u^4+%u^4+%u^4",a,b,c,d);
     if(GCD==1)  printf("  (primitive)");
     printf("\n");
     out=fopen("results_euler(4,1,3).txt","a+");
@@ -449,11 +493,19 @@ void finalcheck(unsigned int a, unsigned int b, unsigned int c, unsigned int d)
     if(GCD==1)  fprintf(out,"  (primitive)");
     fprintf(out,"\n");
     fclose(out);
+#ifndef EULER413_LIBRARY
+    if(worker_address!=NULL)  {
+       char request[COORDINATOR_LINE],reply[COORDINATOR_LINE+1];
+       sprintf(request,"SOLUTION %lu %lu Solution found! %u^4=%u^4+%u^4+%u^4%s",worker_unit,worker_lease,a,b,c,d,(GCD==1)?"  (primitive)":"");
+       worker_request(worker_address,request,reply);
+       worker_solutions++;
+    }
+#endif
 
     return;
 }
 
-void compute_d(unsigned int a, unsigned int b, unsigned int c)
+static void compute_d(unsigned int a, unsigned int b, unsigned int c)
 {
 // d^4=a^4-b^4-c^4 so it is easy to compute d using large numbers, but some powmod tricks we can avoid this.
 // speed isn't interesting.
@@ -480,7 +532,7 @@ void compute_d(unsigned int a, unsigned int b, unsigned int c)
    return;
 }
 
-void fastcheck(unsigned int a,unsigned int b)  // faster check for casenumber=2
+static void fastcheck(unsigned int a,unsigned int b)  // faster check for casenumber=2
 {
    unsigned int rem3,rem1024,rem,remainder,f,g,h,i,i17,i29,i481,j,k,l,m,u,w,x,y,z,c1,c2,c3;
    unsigned long long int LA=a,LB=b;
@@ -565,7 +617,7 @@ void fastcheck(unsigned int a,unsigned int b)  // faster check for casenumber=2
    return;
 }
 
-void check(unsigned int a, unsigned int b, unsigned int casenumber)
+static void check(unsigned int a, unsigned int b, unsigned int casenumber)
 {
    if((good13rem[(13+powmod4(a,13)-powmod4(b,13))%13]==0)||(good29rem[(29+powmod4(a,29)-powmod4(b,29))%29]==0))  return;
 
@@ -828,18 +880,808 @@ void check(unsigned int a, unsigned int b, unsigned int casenumber)
 }
 
 
-int main ()  {
+static unsigned int convert120[120]={0,0,1,1,1,1,1,1,1,1,1,1,1,1,1,1,
+1,1,2,2,2,2,2,2,2,2,2,2,2,2,2,2,
+2,2,2,2,2,2,2,2,2,2,3,3,3,3,3,3,
+3,3,4,4,4,4,4,4,4,4,4,4,4,4,4,4,
+4,4,4,4,4,4,4,4,4,4,5,5,5,5,5,5,
+5,5,5,5,5,5,5,5,5,5,6,6,6,6,6,6,
+6,6,7,7,7,7,7,7,7,7,7,7,7,7,7,7,
+7,7,8,8,8,8,8,8};  // used to convert the Table
+
+// PARI code to generate convert120:
+// s=0;for(n=0,119,print1(s",");if(n%16==15,print1("\n"));if((n%8==1)&&(gcd(n,15)==1),s++))
+
+static void extend_Table(unsigned int old_Range)
+{
+// extend Table, isprime and smallprimes from old_Range to Range, old_Range=0 builds them from scratch.
+// For the primes that were already used only the new part of Table is sieved.
+   unsigned int i,j,k,h,st,blocksize,expo,rem120,old_E,G;
+   double DD;
+
+   old_E=0;
+   if(old_Range>0)  old_E=E;
+
+   Table=(unsigned int*) (realloc) (Table,(Range/240+2)*sizeof(unsigned int));
+   
+   // Check if there was enough memory or not.
+   if(Table==NULL)  {
+      printf("Not enough memory on this computer, sorry.\nExit.\n");
+      exit(1);
+   }
+
+   G=Range/240+1;
+   i=0;
+   if(old_Range>0)  i=old_Range/240+2;
+   for(;i<=G;i++)  Table[i]=0xffffffff;
+
+   DD=(double) sqrt((double) 2.0*Range);
+   E=2+(unsigned int) DD;
+   isprime=(unsigned int*) (realloc) (isprime,E*sizeof(unsigned int));
+   
+   for(i=0;i<E;i++)  isprime[i]=1;
+   isprime[0]=0,isprime[1]=0;
+   for(i=2;i*i<E;i++)  {
+       if(isprime[i])  {
+          for(j=i*i;j<E;j+=i)  isprime[j]=0;
+       }
+   }   
+
+   for(i=7;i<E;i+=2)  {
+       if(isprime[i]&&(i%8>1))  {
+          for(j=0;j<120;j++)  {
+              st=i*j;
+              if((st%8==1)&&(st%3>0)&&(st%5>0))  {
+                  blocksize=120*i;
+                  k=st;
+                  // the old part up to 2*old_Range is already sieved by i
+                  if((i<old_E)&&(k<=2*old_Range))  k+=((2*old_Range-k)/blocksize+1)*blocksize;
+                  for(;k<=2*Range;k+=blocksize)  {
+                      expo=0;
+                      h=k;
+                      while(h%i==0)  h/=i,expo++;
+                      if((expo&3)>0)  {                    
+                          rem120=((k/120)<<3)+convert120[k%120];
+                          Table[rem120>>5]&=~Bits[rem120&31];
+                      }
+                  }
+              }
+          }
+       }
+   }
+
+   free(smallprimes);
+   np=0;
+   for(i=3;i<100;i+=2)
+       if(isprime[i]&&(i%8>1))  np++;
+   
+   for(i=101;i<E;i+=8)
+       if(isprime[i])  np++;   
+   
+   smallprimes=(unsigned int*) (malloc) (np*sizeof(unsigned int));
+   np=0;
+   for(i=3;i<100;i+=2)
+       if(isprime[i]&&(i%8>1))  smallprimes[np]=i,np++;
+   
+   for(i=101;i<E;i+=8)
+       if(isprime[i])  smallprimes[np]=i,np++;
+
+   return;
+}
+
+#if defined(__AVX512F__)&&defined(__AVX512CD__)
+static unsigned int filter_b(unsigned int b, unsigned int diff, unsigned int *list)
+{
+// 16 b values at once, the same tests as in the scalar version below
+   unsigned int j,n,num=0;
+   __m512i vb,vm,ve,vq,vr,vt,vidx,vw;
+   __mmask16 live,div;
+   const __m512i zero=_mm512_setzero_si512(),one=_mm512_set1_epi32(1),three=_mm512_set1_epi32(3);
+   const __m512i inv3=_mm512_set1_epi32(0xaaaaaaab),lim3=_mm512_set1_epi32(0x55555555);  // 3*inv3==1 mod 2^32
+   const __m512i inv5=_mm512_set1_epi32(0xcccccccd),lim5=_mm512_set1_epi32(0x33333333);  // 5*inv5==1 mod 2^32
+   const __m512i magic15=_mm512_set1_epi32(0x88888889);  // x/15=(x*magic15)>>35 for x<2^32
+   const __m512i v31=_mm512_set1_epi32(31),v120=_mm512_set1_epi32(120),v7=_mm512_set1_epi32(7);
+   const __m512i vdiff=_mm512_set1_epi32(diff),vstep=_mm512_set1_epi32(16*step_ab);
+
+   if(b+diff>=Range)  return 0;
+   n=(Range-diff-b+step_ab-1)/step_ab;
+   vb=_mm512_add_epi32(_mm512_set1_epi32(b),_mm512_mullo_epi32(_mm512_setr_epi32(0,1,2,3,4,5,6,7,8,9,10,11,12,13,14,15),_mm512_set1_epi32(step_ab)));
+   for(j=0;j<n;j+=16,vb=_mm512_add_epi32(vb,vstep))  {
+       live=0xffff;
+       if(n-j<16)  live=(1<<(n-j))-1;
+       vm=_mm512_add_epi32(_mm512_add_epi32(vb,vb),vdiff);  // m=a+b
+       // a number is divisible by 3 ( or 5 ) iff multiplied by the inverse it is at most lim3 ( or lim5 )
+       ve=zero;
+       div=_mm512_mask_cmple_epu32_mask(live,_mm512_mullo_epi32(vm,inv3),lim3);
+       while(div)  {
+             vm=_mm512_mask_mullo_epi32(vm,div,vm,inv3);
+             ve=_mm512_mask_add_epi32(ve,div,ve,one);
+             div=_mm512_mask_cmple_epu32_mask(div,_mm512_mullo_epi32(vm,inv3),lim3);
+       }
+       live=_mm512_mask_cmpeq_epi32_mask(live,_mm512_and_si512(ve,three),zero);
+       div=_mm512_mask_cmple_epu32_mask(live,_mm512_mullo_epi32(vm,inv5),lim5);
+       while(div)  {
+             vm=_mm512_mask_mullo_epi32(vm,div,vm,inv5);
+             ve=_mm512_mask_add_epi32(ve,div,ve,one);
+             div=_mm512_mask_cmple_epu32_mask(div,_mm512_mullo_epi32(vm,inv5),lim5);
+       }
+       live=_mm512_mask_cmpeq_epi32_mask(live,_mm512_and_si512(ve,three),zero);
+       // remove the factors of two: the lowest set bit of m is at 31-lzcnt(m&-m)
+       vt=_mm512_and_si512(vm,_mm512_sub_epi32(zero,vm));
+       vm=_mm512_srlv_epi32(vm,_mm512_sub_epi32(v31,_mm512_lzcnt_epi32(vt)));
+       live=_mm512_mask_cmpeq_epi32_mask(live,_mm512_and_si512(vm,v7),one);
+       if(live==0)  continue;
+       // rem120=((m/120)<<3)+convert120[m%120], m/120=(m>>3)/15
+       vt=_mm512_srli_epi32(vm,3);
+       vq=_mm512_srli_epi64(_mm512_mul_epu32(vt,magic15),35);
+       vr=_mm512_slli_epi64(_mm512_srli_epi64(_mm512_mul_epu32(_mm512_srli_epi64(vt,32),magic15),35),32);
+       vq=_mm512_mask_blend_epi32(0xaaaa,vq,vr);
+       vr=_mm512_sub_epi32(vm,_mm512_mullo_epi32(vq,v120));
+       vidx=_mm512_mask_i32gather_epi32(zero,live,vr,(int const*) convert120,4);
+       vidx=_mm512_add_epi32(_mm512_slli_epi32(vq,3),vidx);
+       vw=_mm512_mask_i32gather_epi32(zero,live,_mm512_srli_epi32(vidx,5),(int const*) Table,4);
+       live=_mm512_mask_test_epi32_mask(live,vw,_mm512_sllv_epi32(one,_mm512_and_si512(vidx,v31)));
+       _mm512_mask_compressstoreu_epi32(list+num,live,vb);
+       num+=_mm_popcnt_u32(live);
+   }
+   return num;
+}
+#elif defined(__AVX2__)
+static unsigned int filter_b(unsigned int b, unsigned int diff, unsigned int *list)
+{
+// 8 b values at once, the same tests as in the scalar version below
+   unsigned int j,n,num=0,bits;
+   unsigned int lanes[8];
+   __m256i vb,vm,ve,vq,vr,vt,vidx,vw,live,div;
+   const __m256i zero=_mm256_setzero_si256(),one=_mm256_set1_epi32(1),three=_mm256_set1_epi32(3);
+   const __m256i inv3=_mm256_set1_epi32(0xaaaaaaab),lim3=_mm256_set1_epi32(0x55555555);  // 3*inv3==1 mod 2^32
+   const __m256i inv5=_mm256_set1_epi32(0xcccccccd),lim5=_mm256_set1_epi32(0x33333333);  // 5*inv5==1 mod 2^32
+   const __m256i magic15=_mm256_set1_epi32(0x88888889);  // x/15=(x*magic15)>>35 for x<2^32
+   const __m256i v31=_mm256_set1_epi32(31),v120=_mm256_set1_epi32(120),v7=_mm256_set1_epi32(7);
+   const __m256i vdiff=_mm256_set1_epi32(diff),vstep=_mm256_set1_epi32(8*step_ab);
+   const __m256i lane=_mm256_setr_epi32(0,1,2,3,4,5,6,7);
+
+   if(b+diff>=Range)  return 0;
+   n=(Range-diff-b+step_ab-1)/step_ab;
+   vb=_mm256_add_epi32(_mm256_set1_epi32(b),_mm256_mullo_epi32(lane,_mm256_set1_epi32(step_ab)));
+   for(j=0;j<n;j+=8,vb=_mm256_add_epi32(vb,vstep))  {
+       live=_mm256_cmpgt_epi32(_mm256_set1_epi32(n-j),lane);
+       vm=_mm256_add_epi32(_mm256_add_epi32(vb,vb),vdiff);  // m=a+b
+       // a number is divisible by 3 ( or 5 ) iff multiplied by the inverse it is at most lim3 ( or lim5 )
+       ve=zero;
+       vt=_mm256_mullo_epi32(vm,inv3);
+       div=_mm256_and_si256(live,_mm256_cmpeq_epi32(_mm256_min_epu32(vt,lim3),vt));
+       while(!_mm256_testz_si256(div,div))  {
+             vm=_mm256_blendv_epi8(vm,vt,div);
+             ve=_mm256_sub_epi32(ve,div);
+             vt=_mm256_mullo_epi32(vm,inv3);
+             div=_mm256_and_si256(div,_mm256_cmpeq_epi32(_mm256_min_epu32(vt,lim3),vt));
+       }
+       live=_mm256_and_si256(live,_mm256_cmpeq_epi32(_mm256_and_si256(ve,three),zero));
+       vt=_mm256_mullo_epi32(vm,inv5);
+       div=_mm256_and_si256(live,_mm256_cmpeq_epi32(_mm256_min_epu32(vt,lim5),vt));
+       while(!_mm256_testz_si256(div,div))  {
+             vm=_mm256_blendv_epi8(vm,vt,div);
+             ve=_mm256_sub_epi32(ve,div);
+             vt=_mm256_mullo_epi32(vm,inv5);
+             div=_mm256_and_si256(div,_mm256_cmpeq_epi32(_mm256_min_epu32(vt,lim5),vt));
+       }
+       live=_mm256_and_si256(live,_mm256_cmpeq_epi32(_mm256_and_si256(ve,three),zero));
+       // remove the factors of two
+       div=_mm256_and_si256(live,_mm256_cmpeq_epi32(_mm256_and_si256(vm,one),zero));
+       while(!_mm256_testz_si256(div,div))  {
+             vm=_mm256_blendv_epi8(vm,_mm256_srli_epi32(vm,1),div);
+             div=_mm256_and_si256(div,_mm256_cmpeq_epi32(_mm256_and_si256(vm,one),zero));
+       }
+       live=_mm256_and_si256(live,_mm256_cmpeq_epi32(_mm256_and_si256(vm,v7),one));
+       if(_mm256_testz_si256(live,live))  continue;
+       // rem120=((m/120)<<3)+convert120[m%120], m/120=(m>>3)/15
+       vt=_mm256_srli_epi32(vm,3);
+       vq=_mm256_srli_epi64(_mm256_mul_epu32(vt,magic15),35);
+       vr=_mm256_slli_epi64(_mm256_srli_epi64(_mm256_mul_epu32(_mm256_srli_epi64(vt,32),magic15),35),32);
+       vq=_mm256_blend_epi32(vq,vr,0xaa);
+       vr=_mm256_sub_epi32(vm,_mm256_mullo_epi32(vq,v120));
+       vidx=_mm256_mask_i32gather_epi32(zero,(int const*) convert120,vr,live,4);
+       vidx=_mm256_add_epi32(_mm256_slli_epi32(vq,3),vidx);
+       vw=_mm256_mask_i32gather_epi32(zero,(int const*) Table,_mm256_srli_epi32(vidx,5),live,4);
+       vw=_mm256_and_si256(vw,_mm256_sllv_epi32(one,_mm256_and_si256(vidx,v31)));
+       live=_mm256_andnot_si256(_mm256_cmpeq_epi32(vw,zero),live);
+       bits=_mm256_movemask_ps(_mm256_castsi256_ps(live));
+       if(bits)  {
+          _mm256_storeu_si256((__m256i*) lanes,vb);
+          for(;bits;bits&=bits-1)  list[num++]=lanes[__builtin_ctz(bits)];
+       }
+   }
+   return num;
+}
+#else
+static unsigned int filter_b(unsigned int b, unsigned int diff, unsigned int *list)
+{
+// collect the b values b, b+step_ab, ... with a=b+diff<Range for that m=a+b has 4|v3(m), 4|v5(m)
+// and the odd part of m is 1 mod 8 and it is admissible in Table
+   unsigned int expo,m,num=0,rem120;
+
+   for(;b+diff<Range;b+=step_ab)  {
+   m=b+b+diff;
+   expo=0;
+   while(m%3==0)  m/=3,expo++;
+   if((expo&3)==0)  {
+   while(m%5==0)  m/=5,expo++;
+   if((expo&3)==0)  {
+   while((m&1)==0)  m>>=1;
+   if((m&7)==1)  {
+   rem120=((m/120)<<3)+convert120[m%120];
+   if(Bits[rem120&31]&Table[rem120>>5])  list[num]=b,num++;
+   }}}}
+   return num;
+}
+#endif
+
+static void search_b0(unsigned int a0, unsigned int b0, unsigned int type)
+{
+// one search unit: all pairs with a==a0, b==b0 mod 16384 and start_Range<=a<Range
+// type=0 is the first ( special ) search, type=1 is the rest of the complete search
+   unsigned int a,b,f,g,h,j,k,u,a1,b1,T,expo,limit,diff,num,rem120;
+   unsigned int list[256];  // the b values that passed filter_b, there are at most Range/step_ab<195 of them
+
+   if(type==0)  {
+      u=((powmod4(a0,65536)+65536-powmod4(b0,65536))&65535)>>12;
+      if(u>2)  return;
+   }
+
+   for(h=1;h<5;h++)  {
+       for(g=h;g<625;g+=5)  {
+           u=g+625-(a0%625);
+           a1=a0+(((u*inv_16384_625)%625)<<14);
+           T=rem625[g];
+           for(f=T;f<T+4;f++)  {
+               u=Inverserem625[f]+625-(b0%625);
+               b1=b0+(((u*inv_16384_625)%625)<<14);
+               limit=(a1+step_ab-b1)%step_ab;
+               if(limit==0)  limit=step_ab;
+               for(diff=limit;diff<Range;diff+=step_ab)  {
+               //for(a=a1;a<Range;a+=step)  {
+               //    for(b=b1;b<a;b+=step)  {
+               // a-b=diff, note that diff>0
+                       k=diff;
+                       expo=0;
+                       while(k%3==0)  k/=3,expo++;
+                       if((expo&3)==0)  {
+                       while(k%5==0)  k/=5,expo++;
+                       if((expo&3)==0)  {  // not need to set expo=0, because we know that expo%4=0
+                       while((k&1)==0)  k>>=1;
+                       if((k&7)==1)  {
+                       rem120=((k/120)<<3)+convert120[k%120];
+                       if(Bits[rem120&31]&Table[rem120>>5])  {
+                       b=b1;
+                       if(b+diff<start_Range)  b+=((start_Range-diff-b+step_ab-1)/step_ab)*step_ab;
+                       num=filter_b(b,diff,list);
+                       for(j=0;j<num;j++)  {
+                           b=list[j];
+                           a=b+diff;
+                           if(goodrem3125[(3125+rem3125[a%3125]-rem3125[b%3125])/625])  check(a,b,type+1);
+                       }
+                       }}}
+                   }
+               }
+           }
+       }
+   }
+   return;
+}
+
+static void build_tables(void)
+{
+// all tables of the search up to Range, the multiplier tables do not depend on Range
+   unsigned int h,i,j,k,pos,s,u;
+   unsigned int stored[512];
+   unsigned int count;
+
+   R=(unsigned int*)  malloc(table_size*sizeof(unsigned int));
+   L=(unsigned int*)  malloc(table_size*sizeof(unsigned int));
+   temp=(unsigned int*)  malloc(table_size*sizeof(unsigned int));
+
+
+   rem_mult_d[0][0]=0,rem_mult_d[1][0]=0,rem_mult_d[2][0]=0,rem_mult_d[3][0]=0;
+   rem_mult_d[0][1]=0,rem_mult_d[1][1]=625,rem_mult_d[2][1]=81,rem_mult_d[3][1]=16;
+
+   for(i=0;i<625;i++)  Inverserem625[i]=0;
+   for(i=0;i<625;i++)  {
+       u=powmod4(i,625);
+       rem625[i]=u;
+       if(u!=0)  {
+          pos=Inverserem625[u-1];
+          Inverserem625[u+pos]=i,Inverserem625[u-1]++;
+       }
+   }
+
+   for(i=0;i<3125;i++)  rem3125[i]=powmod4(i,3125);
+
+   for(i=0;i<=3;i++)  {
+        for(j=0;j<3125;j++)  Inverserem[i][j]=0;
+   }
+   for(i=1;i<=3;i++)  {
+       s=multiplier[i];
+       k=factors[i];
+       for(j=0;j<STEP[i];j++)  {
+           u=powmod4(j,s);
+           if(j%k>0)  pos=Inverserem[i][u-1],Inverserem[i][u+pos]=j,Inverserem[i][u-1]++;
+       }
+   }
+
+   extend_Table(0);
+
+   // the multiplier tables don't depend on Range ( they are good for every R<195 ),
+   // so these are not rebuilt when the searched range is extended
+   multipliers17=(unsigned int**) (malloc) (17*17*sizeof(unsigned int*));
+   multipliers29=(unsigned int**) (malloc) (29*29*sizeof(unsigned int*));
+   multipliers481=(unsigned int**) (malloc) (481*481*sizeof(unsigned int*));
+   specialmultipliers29=(unsigned int**) (malloc) (29*29*sizeof(unsigned int*));
+   specialmultipliers481=(unsigned int**) (malloc) (481*481*sizeof(unsigned int*));
+   count17=(unsigned int*) (malloc) (17*17*sizeof(int));
+   count29=(unsigned int*) (malloc) (29*29*sizeof(int));
+   count481=(unsigned int*) (malloc) (481*481*sizeof(int));
+   specialcount29=(unsigned int*) (malloc) (29*29*sizeof(int));
+   specialcount481=(unsigned int*) (malloc) (481*481*sizeof(int));
+
+   for(i=0;i<17;i++)  {
+       for(j=0;j<17;j++)  {
+           count=0;
+           for(k=0;k<17;k++)  {
+               if(ispowerrem17[(i+17-rem17[(j+k*2375680)%17])%17])  stored[count]=k,count++;
+           }
+           h=17*i+j;
+           count17[h]=count;
+           multipliers17[h]=(unsigned int*) (malloc) (count*sizeof(unsigned int));
+           for(k=0;k<count;k++)  multipliers17[h][k]=stored[k]; 
+       }
+   }
+
+   for(i=0;i<29;i++)  {
+       for(j=0;j<29;j++)  {
+           count=0;
+           for(k=0;k<29;k++)  {
+               if(ispowerrem29[(i+29-rem29[(j+k*81920)%29])%29])  stored[count]=k,count++;
+           }
+           h=29*i+j;
+           count29[h]=count;
+           multipliers29[h]=(unsigned int*) (malloc) (count*sizeof(unsigned int));
+           for(k=0;k<count;k++)  multipliers29[h][k]=stored[k]; 
+       }
+   }
+
+   for(i=0;i<481;i++)  {  // 13*37=481
+       for(j=0;j<481;j++)  {
+           count=0;
+           for(k=0;k<50;k++)  {  // (unsigned int) 194*16384*625/5/17/29/16384=49
+               if(ispowerrem13[(i+13-rem13[(j+k*40386560)%13])%13]&&ispowerrem37[(i+37-rem37[(j+k*40386560)%37])%37])  stored[count]=k,count++;
+           }
+           h=481*i+j;
+           count481[h]=count;
+           multipliers481[h]=(unsigned int*) (malloc) (count*sizeof(unsigned int));
+           for(k=0;k<count;k++)  multipliers481[h][k]=stored[k]; 
+       }
+   }
+
+   for(i=0;i<29;i++)  {
+       for(j=0;j<29;j++)  {
+           count=0;
+           for(k=0;k<29;k++)  {
+               if(ispowerrem29[(i+29-rem29[(j+k*1310720)%29])%29])  stored[count]=k,count++;
+          }
+           h=29*i+j;
+           specialcount29[h]=count;
+           specialmultipliers29[h]=(unsigned int*) (malloc) (count*sizeof(unsigned int));
+           for(k=0;k<count;k++)  specialmultipliers29[h][k]=stored[k]; 
+       }
+   }
+
+   for(i=0;i<481;i++)  {  // 13*37=481
+       for(j=0;j<481;j++)  {
+           count=0;
+           for(k=0;k<53;k++)  {  // (unsigned int) 194*16384*625/5/29/262144=52
+               if(ispowerrem13[(i+13-rem13[(j+k*38010880)%13])%13]&&ispowerrem37[(i+37-rem37[(j+k*38010880)%37])%37])  stored[count]=k,count++;
+           }
+           h=481*i+j;
+           specialcount481[h]=count;
+           specialmultipliers481[h]=(unsigned int*) (malloc) (count*sizeof(unsigned int));
+           for(k=0;k<count;k++)  specialmultipliers481[h][k]=stored[k]; 
+       }
+   }
+
+   return;
+}
+
+static void free_tables(void)
+{
+   unsigned int i;
+
+   free(isprime);
+   free(Table);
+   free(L);
+   free(R);
+   free(temp);
+   free(count17);
+   free(count29);
+   free(count481);
+   free(specialcount29);
+   free(specialcount481);
+   for(i=0;i<289;i++)  free(multipliers17[i]);
+   free(multipliers17);
+   for(i=0;i<841;i++)  free(multipliers29[i]);
+   free(multipliers29);
+   for(i=0;i<231361;i++) free(multipliers481[i]);
+   free(multipliers481);
+   for(i=0;i<841;i++)  free(specialmultipliers29[i]);
+   free(specialmultipliers29);
+   for(i=0;i<231361;i++) free(specialmultipliers481[i]);
+   free(specialmultipliers481);
+   free(smallprimes);
+   Table=NULL,isprime=NULL,smallprimes=NULL,E=0;
+
+   return;
+}
+
+
+#ifndef EULER413_LIBRARY
+static void save_work(unsigned int R_parameter, unsigned int a0, unsigned int nexttype, unsigned int end_a0, unsigned int b0)
+{
+// The workfile is written to a temporary file and renamed, so a crash or a full disk while saving leaves the previous one intact.
+   FILE* workfile;
+   int error;
+
+   pthread_mutex_lock(&work_lock);
+   workfile=fopen("euler413work.tmp","w");
+   if(workfile==NULL)  {
+      printf("Cannot write the workfile!\n");
+      pthread_mutex_unlock(&work_lock);
+      return;
+   }
+   error=(fprintf(workfile,"// Please don't modify this file\n")<0);
+   error|=(fprintf(workfile,"R_parameter=%u\n",R_parameter)<0);
+   error|=(fprintf(workfile,"typesearch=%u\n",complete_search)<0);
+   error|=(fprintf(workfile,"start_a0=%u\n",a0)<0);
+   error|=(fprintf(workfile,"nexttype=%u\n",nexttype)<0);
+   error|=(fprintf(workfile,"end_a0=%u\n",end_a0)<0);
+   error|=(fprintf(workfile,"start_b0=%u\n",b0)<0);
+   error|=(fprintf(workfile,"start_R_parameter=%u\n",start_Range/(625*16384))<0);
+   error|=(fflush(workfile)!=0);
+   error|=(fsync(fileno(workfile))!=0);
+   error|=(fclose(workfile)!=0);
+   if(error||rename("euler413work.tmp","euler413work.txt"))  {
+      printf("Cannot write the workfile, the previous one is kept!\n");
+      remove("euler413work.tmp");
+   }
+   pthread_mutex_unlock(&work_lock);
+
+   return;
+}
+
+
+static void stop_handler(int sig)
+{
+   stop_request=1;
+}
+
+static void* checkpoint_timer(void* arg)
+{
+// the search loop only polls save_request and stop_request, the time is measured here.
+// If the search doesn't reach the next unit in STOP_TIMEOUT seconds after a signal then
+// save the unit that is searched now ( so it will be searched again ) and exit.
+// A worker sends the heartbeats of its lease from here, and it gives the a0 value back instead of saving it.
+   unsigned int elapsed=0,stopping=0,beat=0;
+   unsigned long int lease;
+   char request[COORDINATOR_LINE],reply[COORDINATOR_LINE+1];
+
+   for(;;)  {
+       sleep(1);
+       elapsed++;
+       if(elapsed>=TIME_INTERVAL)  elapsed=0,save_request=1;
+       if(worker_active&&(++beat>=worker_heartbeat))  {
+          beat=0;
+          lease=coordinator_heartbeat(worker_address,&worker_unit,&worker_lease);
+          if(lease>0)  lost_lease=lease;
+       }
+       if(stop_request)  {
+          stopping++;
+          if(stopping>=STOP_TIMEOUT)  {
+             if(worker_address!=NULL)  {
+                if(worker_active)  {
+                   sprintf(request,"FAIL %lu %lu stopped by a signal",worker_unit,worker_lease);
+                   coordinator_request(worker_address,request,reply);
+                }
+             }
+             else  save_work(work_R_parameter,work_a0,work_type,work_end_a0,work_b0);
+             printf("\nStopped by a signal, the work is saved at a0=%u,type=%u,b0=%u\n",work_a0,work_type,work_b0);
+             fflush(stdout);
+             _exit(0);
+          }
+       }
+   }
+   return NULL;
+}
+
+static void plan_work(unsigned int start_a0, unsigned int end_a0, double build_time)
+{
+// dry run for the -plan mode: time a random sample of (a0,b0) units on this computer
+// and extrapolate the cost of the whole job, the units of the two types are sampled separately
+   unsigned int a0,b0,i,type,num_a0,num_types,num0,shards,first,last;
+   unsigned int n[2],list0[64];
+   int test,got;
+   double t,mean,var,total,total_var,low,high,memory,hours=0.0;
+   double units[2],sum[2],sum2[2];
+   clock_t c,start;
+
+   if(end_a0<start_a0)  {
+      printf("There is no a0==1 mod 8 in the given interval, nothing to do.\n");
+      return;
+   }
+   num_a0=(end_a0-start_a0)/8+1;
+   num_types=1+complete_search;
+
+   srand(time(NULL));
+   for(i=0;i<2;i++)  n[i]=0,sum[i]=0.0,sum2[i]=0.0;
+   units[0]=0.0;
+   units[1]=2048.0*num_a0;  // b0=0,8,...,16376 for type=1
+   type=0;
+   start=clock();
+   while((n[0]<PLAN_MIN_SAMPLES)||(n[num_types-1]<PLAN_MIN_SAMPLES)||(clock()-start<PLAN_TIME*CLOCKS_PER_SEC))  {
+         a0=start_a0+8*(((((unsigned int) rand())<<15)^rand())%num_a0);
+         if(type==0)  {
+            // the b0 values of type=0 for this a0, the same as in the search
+            b0=a0&1023;
+            if(b0>512)  b0=1024-b0;
+            for(num0=0;b0<16384;num0++)  {
+                list0[num0]=b0;
+                if((b0&1023)<512)  b0+=1024-2*(b0&1023);
+                else               b0+=2048-2*(b0&1023);
+            }
+            b0=list0[rand()%num0];
+         }
+         else  b0=8*(rand()%2048);
+         c=clock();
+         search_b0(a0,b0,type);
+         t=(double) (clock()-c)/CLOCKS_PER_SEC;
+         sum[type]+=t,sum2[type]+=t*t,n[type]++;
+         type=(type+1)%num_types;
+   }
+
+   for(a0=start_a0;a0<=end_a0;a0+=8)  {
+       b0=a0&1023;
+       if(b0>512)  b0=1024-b0;
+       while(b0<16384)  {
+             units[0]+=1.0;
+             if((b0&1023)<512)  b0+=1024-2*(b0&1023);
+             else               b0+=2048-2*(b0&1023);
+       }
+   }
+
+   // stratified estimate with normal 95% confidence bounds
+   total=0.0,total_var=0.0;
+   for(type=0;type<num_types;type++)  {
+       mean=sum[type]/n[type];
+       var=(sum2[type]-n[type]*mean*mean)/(n[type]-1);
+       if(var<0.0)  var=0.0;
+       total+=units[type]*mean;
+       total_var+=units[type]*units[type]*var/n[type];
+       printf("type=%u: %.0f units, sampled %u of them, %.6f sec per unit on average\n",type,units[type],n[type],mean);
+   }
+   low=(total-1.96*sqrt(total_var))/3600.0;
+   high=(total+1.96*sqrt(total_var))/3600.0;
+   if(low<0.0)  low=0.0;
+   printf("Estimated time: %.2f core-hours ( 95%% confidence: %.2f-%.2f core-hours )\n",total/3600.0,low,high);
+   printf("Building the tables takes %.1f sec for each job\n",build_time);
+
+   memory=(double) (Range/240+2)+E+np+3*table_size;
+   memory+=(double) (sizeof(unsigned int)+sizeof(unsigned int*))/sizeof(unsigned int)*(17*17+2*29*29+2*481*481);
+   for(i=0;i<17*17;i++)  memory+=count17[i];
+   for(i=0;i<29*29;i++)  memory+=count29[i]+specialcount29[i];
+   for(i=0;i<481*481;i++)  memory+=count481[i]+specialcount481[i];
+   memory*=sizeof(unsigned int);
+   printf("Estimated peak memory: %.1f MB\n",memory/1048576.0);
+
+   test=1;
+   while(test)  {
+         test=0;
+         printf("Give the wanted running time of one job in hours: ");
+         got=scanf("%lf",&hours);
+         if(got==EOF)  return;
+         if((got!=1)||(hours<=0.0))  {
+            scanf("%*[^\n]");  // skip the rest of a wrong answer
+            printf("Wrong answer! It should be a positive number of hours\n"),test=1;
+         }
+   }
+   shards=(unsigned int) (high/hours)+1;
+   if(shards>num_a0)  shards=num_a0;
+   printf("Suggested number of jobs: %u ( at most %.2f hours for each )\n",shards,high/shards+build_time/3600.0);
+   if(shards>PLAN_MAX_JOBS_LIST)  printf("Each job gets about %u a0 values\n",num_a0/shards);
+   else  {
+      for(i=0;i<shards;i++)  {
+          first=i*num_a0/shards;
+          last=(i+1)*num_a0/shards-1;
+          printf("job %u: start_a0=%u, end_a0=%u\n",i+1,start_a0+8*first,start_a0+8*last);
+      }
+   }
+
+   return;
+}
+#endif
+
+int euler413_init(euler413_context* ctx)
+{
+   unsigned int old_Range;
+
+   if((ctx->R_parameter<=0)||(ctx->R_parameter>=195))  return 1;
+   if(ctx->start_R_parameter>=ctx->R_parameter)  return 1;
+   if(ctx->complete_search>1)  return 1;
+
+   context=ctx;
+   old_Range=Range;
+   Range=ctx->R_parameter*625*16384;
+   start_Range=ctx->start_R_parameter*625*16384;
+   complete_search=ctx->complete_search;
+   if(Table==NULL)  build_tables();
+   else if(Range>old_Range)  extend_Table(old_Range);
+   else if(Range<old_Range)  extend_Table(0);
+
+   return 0;
+}
+
+int euler413_search_unit(euler413_context* ctx, unsigned int a0, unsigned int type, unsigned int b0)
+{
+   unsigned int r1=a0&1023,r2=b0&1023;
+
+   if((ctx!=context)||(Table==NULL))  return 1;
+   if(((a0&7)!=1)||(a0>16384)||(b0>=16384)||(type>complete_search))  return 1;
+   if((type==0)&&(r1!=r2)&&((r1+r2)!=1024))  return 1;
+   if((type==1)&&((b0&7)!=0))  return 1;
+
+   search_b0(a0,b0,type);
+
+   return 0;
+}
+
+int euler413_search_a0(euler413_context* ctx, unsigned int a0)
+{
+   unsigned int b0;
+
+   if((ctx!=context)||(Table==NULL)||((a0&7)!=1)||(a0>16384))  return 1;
+
+   b0=a0&1023;
+   if(b0>512)  b0=1024-b0;
+   while(b0<16384)  {
+         search_b0(a0,b0,0);
+         if(ctx->progress!=NULL)  ctx->progress(ctx->user,a0,0,b0);
+         if((b0&1023)<512)  b0+=1024-2*(b0&1023);
+         else               b0+=2048-2*(b0&1023);
+   }
+   if(complete_search)  {
+      for(b0=0;b0<16384;b0+=8)  {
+          search_b0(a0,b0,1);
+          if(ctx->progress!=NULL)  ctx->progress(ctx->user,a0,1,b0);
+      }
+   }
+
+   return 0;
+}
+
+void euler413_free(euler413_context* ctx)
+{
+   if(Table!=NULL)  free_tables();
+   Range=0;
+   context=NULL;
+
+   return;
+}
+
+#ifndef EULER413_LIBRARY
+static void worker_search(unsigned int R_parameter, unsigned int start_R_parameter)
+{
+// -worker: the a0 values are leased from the coordinator one by one, see coordinator.h, the unit u is a0=8*u+1
+// ( all a0==1 mod 8 up to 16384 ), an a0 is searched from its first b0 and the coordinator keeps the finished ones,
+// so the worker has no workfile. Run one worker for each core, they can be on more computers.
+   char name[64],search[256],request[COORDINATOR_LINE],reply[COORDINATOR_LINE+1];
+   unsigned long int u,lease,heartbeat;
+   unsigned int a0,b0;
+   time_t seconds;
+
+   gethostname(name,sizeof(name));
+   name[sizeof(name)-1]=0;
+   sprintf(search,"euler413,R=%u,R0=%u,typesearch=%u",R_parameter,start_R_parameter,complete_search);
+   while(!stop_request)  {
+      sprintf(request,"LEASE %s 0 2047 %s:%d",search,name,(int) getpid());
+      if(worker_request(worker_address,request,reply))  {
+         printf("The coordinator at %s is not reachable, exit.\n",worker_address);
+         return;
+      }
+      if(!strcmp(reply,"DONE"))  {
+         printf("All a0 values are finished.\n");
+         return;
+      }
+      if(!memcmp(reply,"WAIT ",5))  {
+         sleep(strtoul(reply+5,NULL,10));
+         continue;
+      }
+      if((sscanf(reply,"UNIT %lu %lu %lu",&u,&lease,&heartbeat)!=3)||(u>2047))  {
+         printf("The coordinator refused the work: %s\n",reply);
+         return;
+      }
+      worker_unit=u,worker_lease=lease,worker_heartbeat=heartbeat,worker_solutions=0;
+      worker_active=1;
+      a0=8*u+1;
+      printf("Testing: a0=%u\n",a0);
+      seconds=time(NULL);
+      // the units of a0 in the same order as in euler413_search_a0()
+      b0=a0&1023;
+      if(b0>512)  b0=1024-b0;
+      while((b0<16384)&&(!stop_request)&&(lost_lease!=lease))  {
+            work_a0=a0,work_type=0,work_b0=b0;
+            search_b0(a0,b0,0);
+            if((b0&1023)<512)  b0+=1024-2*(b0&1023);
+            else               b0+=2048-2*(b0&1023);
+      }
+      if(complete_search)
+         for(b0=0;(b0<16384)&&(!stop_request)&&(lost_lease!=lease);b0+=8)  {
+             work_a0=a0,work_type=1,work_b0=b0;
+             search_b0(a0,b0,1);
+         }
+      worker_active=0;
+      if(lost_lease==lease)  {
+         printf("The lease of a0=%u timed out, it is searched by an other worker.\n",a0);
+         continue;
+      }
+      if(stop_request)  {
+         sprintf(request,"FAIL %lu %lu stopped by a signal",u,lease);
+         worker_request(worker_address,request,reply);
+         printf("Stopped by a signal, a0=%u is given back to the coordinator\n",a0);
+         return;
+      }
+      sprintf(request,"RESULT %lu %lu %ld %lu",u,lease,(long int) (time(NULL)-seconds),worker_solutions);
+      worker_request(worker_address,request,reply);
+      printf("Finished: a0=%u,Range=%u,Time: %lds\n",a0,Range,(long int) (time(NULL)-seconds));
+   }
 
-   int test;
+   return;
+}
 
-   unsigned int R_parameter,nexttype;
+int main (int argc, char *argv[])  {
+
+   int test,plan;
+
+   unsigned int R_parameter,start_R_parameter,nexttype;
    unsigned int start_a0,end_a0,start_b0;  
    char typesearch[32],continuework[32],inputs[64];
 
    FILE* workfile;
-   workfile=fopen("euler413work.txt","r");
+   // -worker address R R0 y|n: lease the a0 values from the coordinator at address ( host:port or the path of a
+   // local socket ), the other parameters are the answers of the questions below, an unfinished work is ignored
+   if((argc>1)&&(!strcmp(argv[1],"-worker")))  {
+      if((argc<6)||(atoi(argv[3])<=0)||(atoi(argv[3])>=195)||(atoi(argv[4])<0)||(atoi(argv[4])>=atoi(argv[3])))  {
+         printf("Usage: euler413 -worker address R R0 y|n, where 0<R<195, 0<=R0<R and y is the full search\n");
+         return 1;
+      }
+      worker_address=argv[2];
+      R_parameter=atoi(argv[3]),start_R_parameter=atoi(argv[4]);
+      complete_search=(argv[5][0]=='y');
+      Range=R_parameter*625*16384;
+      start_Range=start_R_parameter*625*16384;
+      printf("Building up some tables\n");
+      build_tables();
+      printf("Done\n");
+      pthread_t timer;
+      signal(SIGTERM,stop_handler);
+      signal(SIGINT,stop_handler);
+      pthread_create(&timer,NULL,checkpoint_timer,NULL);
+      worker_search(R_parameter,start_R_parameter);
+      free_tables();
+      return 0;
+   }
+   // in the -plan mode only estimate the cost of a new job, an unfinished work is ignored
+   plan=(argc>1)&&(!strcmp(argv[1],"-plan"));
+   workfile=NULL;
+   if(!plan)  workfile=fopen("euler413work.txt","r");
    if(workfile==NULL)  {
-      printf("I haven't found unfinished work!\n");
+      if(!plan)  printf("I haven't found unfinished work!\n");
       test=1;
       while(test)  {
             test=0;
@@ -849,6 +1691,15 @@ int main ()  {
       }
       Range=R_parameter*625*16384;
       test=1;
+      while(test)  {
+            test=0;
+            printf("Please give the R parameter of the already searched range ( 0 if there is no such range ),\n");
+            printf("the search will be R0*10240000<=a<R*10240000. R0=");
+            scanf("%u",&start_R_parameter);
+            if(start_R_parameter>=R_parameter)  printf("Bad R0 parameter, it should be 0<=R0<R\n"),test=1;
+      }
+      start_Range=start_R_parameter*625*16384;
+      test=1;
       while(test)  {
             test=0;
             printf("Do you want to start an exhaustive search in this Range or\n");
@@ -947,6 +1798,9 @@ int main ()  {
                    remove("euler413work.txt");
                    exit(1);
             }
+            // the workfiles of the older versions have no start_R_parameter line
+            start_R_parameter=0;
+            if((fgets(inputs,sizeof(inputs),workfile)!=NULL)&&(!memcmp(inputs,"start_R_parameter=",18)))  start_R_parameter=atol(&inputs[18]);
            if((R_parameter<=0)||(R_parameter>=195))  {
                printf("In the workfile: bad R parameter, it should be 0<R<195\n");
                printf("I've removed the workfile!\n");            
@@ -955,6 +1809,14 @@ int main ()  {
                remove("euler413work.txt");
                exit(1);
             }
+            if(start_R_parameter>=R_parameter)  {
+               printf("In the workfile: bad start_R parameter, it should be 0<=start_R<R\n");
+               printf("I've removed the workfile!\n");            
+               printf("Rerun the program. Exit.\n");
+               fclose(workfile);
+               remove("euler413work.txt");
+               exit(1);
+            }
             if(complete_search>1)  {
                printf("In the workfile: bad typesearch, it should be 1 for fullsearch and 0 for special search!\n");
                printf("I've removed the workfile!\n");            
@@ -1005,208 +1867,17 @@ int main ()  {
                exit(1);
             }
          printf("Continue the computation at a0=%u,type=%u,b0=%u for R=%u\n",start_a0,nexttype,start_b0,R_parameter);
+         if(start_R_parameter>0)  printf("The range below R0=%u is already searched\n",start_R_parameter);
          Range=R_parameter*625*16384;
+         start_Range=start_R_parameter*625*16384;
          fclose(workfile);
    }
 
-   R=(unsigned int*)  malloc(table_size*sizeof(unsigned int));
-   L=(unsigned int*)  malloc(table_size*sizeof(unsigned int));
-   temp=(unsigned int*)  malloc(table_size*sizeof(unsigned int));
-
-   unsigned int rem625[625];
-   unsigned int rem3125[3125];
-   unsigned int Inverserem625[625];
-   unsigned int *Table;
-   unsigned int inv_16384_625;
-
-   unsigned int a,b,f,g,h,i,j,k,m,pos,s,step,u,limit,diff;
-   unsigned int a0,a1,b0,b1,T,expo,blocksize,st,rem120,E,G,allsec;
-   unsigned int *isprime;
-   unsigned int A[10];
-   unsigned int convert120[120]={0,0,1,1,1,1,1,1,1,1,1,1,1,1,1,1,
-1,1,2,2,2,2,2,2,2,2,2,2,2,2,2,2,
-2,2,2,2,2,2,2,2,2,2,3,3,3,3,3,3,
-3,3,4,4,4,4,4,4,4,4,4,4,4,4,4,4,
-4,4,4,4,4,4,4,4,4,4,5,5,5,5,5,5,
-5,5,5,5,5,5,5,5,5,5,6,6,6,6,6,6,
-6,6,7,7,7,7,7,7,7,7,7,7,7,7,7,7,
-7,7,8,8,8,8,8,8};  // used to convert the Table
-
-
-// PARI code to generate convert120:
-// s=0;for(n=0,119,print1(s",");if(n%16==15,print1("\n"));if((n%8==1)&&(gcd(n,15)==1),s++))
-
-   double DD;
-
+   unsigned int a0,b0,allsec;
+   clock_t build_start=clock();
    printf("Building up some tables\n");
 
-   A[0]=1,A[1]=1,A[2]=1,A[3]=0,A[4]=0;
-   A[5]=1,A[6]=1,A[7]=1,A[8]=0,A[9]=0;
-
-   rem_mult_d[0][0]=0,rem_mult_d[1][0]=0,rem_mult_d[2][0]=0,rem_mult_d[3][0]=0;
-   rem_mult_d[0][1]=0,rem_mult_d[1][1]=625,rem_mult_d[2][1]=81,rem_mult_d[3][1]=16;
-
-   Table=(unsigned int*) (malloc) ((Range/240+2)*sizeof(unsigned int));
-   
-   // Check if there was enough memory or not.
-   if(Table==NULL)  {
-      printf("Not enough memory on this computer, sorry.\nExit.\n");
-      exit(1);
-   }
-
-   for(i=0;i<625;i++)  Inverserem625[i]=0;
-   for(i=0;i<625;i++)  {
-       u=powmod4(i,625);
-       rem625[i]=u;
-       if(u!=0)  {
-          pos=Inverserem625[u-1];
-          Inverserem625[u+pos]=i,Inverserem625[u-1]++;
-       }
-   }
-
-   for(i=0;i<3125;i++)  rem3125[i]=powmod4(i,3125);
-
-   for(i=0;i<=3;i++)  {
-        for(j=0;j<3125;j++)  Inverserem[i][j]=0;
-   }
-   for(i=1;i<=3;i++)  {
-       s=multiplier[i];
-       k=factors[i];
-       for(j=0;j<STEP[i];j++)  {
-           u=powmod4(j,s);
-           if(j%k>0)  pos=Inverserem[i][u-1],Inverserem[i][u+pos]=j,Inverserem[i][u-1]++;
-       }
-   }
-
-   DD=(double) sqrt((double) 2.0*Range);
-   E=2+(unsigned int) DD;
-   isprime=(unsigned int*) (malloc) (E*sizeof(unsigned int));
-   
-   G=Range/240+1;
-   for(i=0;i<=G;i++)  Table[i]=0xffffffff;
-   
-   for(i=0;i<E;i++)  isprime[i]=1;
-   isprime[0]=0,isprime[1]=0;
-   for(i=2;i*i<E;i++)  {
-       if(isprime[i])  {
-          for(j=i*i;j<E;j+=i)  isprime[j]=0;
-       }
-   }   
-
-   for(i=7;i<E;i+=2)  {
-       if(isprime[i]&&(i%8>1))  {
-          for(j=0;j<120;j++)  {
-              st=i*j;
-              if((st%8==1)&&(st%3>0)&&(st%5>0))  {
-                  blocksize=120*i;
-                  for(k=st;k<=2*Range;k+=blocksize)  {
-                      expo=0;
-                      h=k;
-                      while(h%i==0)  h/=i,expo++;
-                      if((expo&3)>0)  {                    
-                          rem120=((k/120)<<3)+convert120[k%120];
-                          Table[rem120>>5]&=~Bits[rem120&31];
-                      }
-                  }
-              }
-          }
-       }
-   }
-
-   for(i=3;i<100;i+=2)
-       if(isprime[i]&&(i%8>1))  np++;
-   
-   for(i=101;i<E;i+=8)
-       if(isprime[i])  np++;   
-   
-   smallprimes=(unsigned int*) (malloc) (np*sizeof(unsigned int));
-   np=0;
-   for(i=3;i<100;i+=2)
-       if(isprime[i]&&(i%8>1))  smallprimes[np]=i,np++;
-   
-   for(i=101;i<E;i+=8)
-       if(isprime[i])  smallprimes[np]=i,np++;
-
-   unsigned int stored[512];
-   unsigned int count;
-   multipliers17=(unsigned int**) (malloc) (17*17*sizeof(unsigned int));
-   multipliers29=(unsigned int**) (malloc) (29*29*sizeof(unsigned int));
-   multipliers481=(unsigned int**) (malloc) (481*481*sizeof(unsigned int));
-   specialmultipliers29=(unsigned int**) (malloc) (29*29*sizeof(unsigned int));
-   specialmultipliers481=(unsigned int**) (malloc) (481*481*sizeof(unsigned int));
-   count17=(unsigned int*) (malloc) (17*17*sizeof(int));
-   count29=(unsigned int*) (malloc) (29*29*sizeof(int));
-   count481=(unsigned int*) (malloc) (481*481*sizeof(int));
-   specialcount29=(unsigned int*) (malloc) (29*29*sizeof(int));
-   specialcount481=(unsigned int*) (malloc) (481*481*sizeof(int));
-
-   for(i=0;i<17;i++)  {
-       for(j=0;j<17;j++)  {
-           count=0;
-           for(k=0;k<17;k++)  {
-               if(ispowerrem17[(i+17-rem17[(j+k*2375680)%17])%17])  stored[count]=k,count++;
-           }
-           h=17*i+j;
-           count17[h]=count;
-           multipliers17[h]=(unsigned int*) (malloc) (count*sizeof(unsigned int));
-           for(k=0;k<count;k++)  multipliers17[h][k]=stored[k]; 
-       }
-   }
-
-   for(i=0;i<29;i++)  {
-       for(j=0;j<29;j++)  {
-           count=0;
-           for(k=0;k<29;k++)  {
-               if(ispowerrem29[(i+29-rem29[(j+k*81920)%29])%29])  stored[count]=k,count++;
-           }
-           h=29*i+j;
-           count29[h]=count;
-           multipliers29[h]=(unsigned int*) (malloc) (count*sizeof(unsigned int));
-           for(k=0;k<count;k++)  multipliers29[h][k]=stored[k]; 
-       }
-   }
-
-   for(i=0;i<481;i++)  {  // 13*37=481
-       for(j=0;j<481;j++)  {
-           count=0;
-           for(k=0;k<50;k++)  {  // (unsigned int) 194*16384*625/5/17/29/16384=49
-               if(ispowerrem13[(i+13-rem13[(j+k*40386560)%13])%13]&&ispowerrem37[(i+37-rem37[(j+k*40386560)%37])%37])  stored[count]=k,count++;
-           }
-           h=481*i+j;
-           count481[h]=count;
-           multipliers481[h]=(unsigned int*) (malloc) (count*sizeof(unsigned int));
-           for(k=0;k<count;k++)  multipliers481[h][k]=stored[k]; 
-       }
-   }
-
-   for(i=0;i<29;i++)  {
-       for(j=0;j<29;j++)  {
-           count=0;
-           for(k=0;k<29;k++)  {
-               if(ispowerrem29[(i+29-rem29[(j+k*1310720)%29])%29])  stored[count]=k,count++;
-          }
-           h=29*i+j;
-           specialcount29[h]=count;
-           specialmultipliers29[h]=(unsigned int*) (malloc) (count*sizeof(unsigned int));
-           for(k=0;k<count;k++)  specialmultipliers29[h][k]=stored[k]; 
-       }
-   }
-
-   for(i=0;i<481;i++)  {  // 13*37=481
-       for(j=0;j<481;j++)  {
-           count=0;
-           for(k=0;k<53;k++)  {  // (unsigned int) 194*16384*625/5/29/262144=52
-               if(ispowerrem13[(i+13-rem13[(j+k*38010880)%13])%13]&&ispowerrem37[(i+37-rem37[(j+k*38010880)%37])%37])  stored[count]=k,count++;
-           }
-           h=481*i+j;
-           specialcount481[h]=count;
-           specialmultipliers481[h]=(unsigned int*) (malloc) (count*sizeof(unsigned int));
-           for(k=0;k<count;k++)  specialmultipliers481[h][k]=stored[k]; 
-       }
-   }
-
-   step=625*16384;
-   inv_16384_625=14;// it is modinv(16384,625)
+   build_tables();
 
    printf("Done\n");
 
@@ -1215,6 +1886,11 @@ int main ()  {
    
    start_a0=(((start_a0+6)>>3)<<3)+1;
    end_a0=(((end_a0-1)>>3)<<3)+1;
+
+   if(plan)  {
+      plan_work(start_a0,end_a0,(double) (clock()-build_start)/CLOCKS_PER_SEC);
+      return 0;
+   }
 
    // modify the original start_b0 value
    unsigned int r1=start_a0&1023,r2=start_b0&1023;
@@ -1229,74 +1905,31 @@ int main ()  {
       start_b0=((start_b0+7)>>3)<<3;
    }
 
+   work_R_parameter=R_parameter,work_end_a0=end_a0;
+   work_a0=start_a0,work_type=nexttype,work_b0=start_b0;
+   pthread_t timer;
+   signal(SIGTERM,stop_handler);
+   signal(SIGINT,stop_handler);
+   pthread_create(&timer,NULL,checkpoint_timer,NULL);
+
 // start the time after the tables build up
    time_t seconds=time(NULL);
-   time_t previous_update=seconds;
    time_t date;
 
    for(a0=start_a0;a0<=end_a0;a0+=8)  {  // Note that a0==1 mod 8 should be to find primitive solutions.
    printf("Testing: a0=%u\n",a0);
    if((start_a0<a0)||(nexttype==0))  {
         for(b0=start_b0;b0<16384;)  {
-           if(time(NULL)-previous_update>TIME_INTERVAL)  {
-              previous_update=time(NULL);
-              remove("euler413work.txt");
-              workfile=fopen("euler413work.txt","a+");
-              fprintf(workfile,"// Please don't modify this file\n");
-              fprintf(workfile,"R_parameter=%u\n",R_parameter);
-              fprintf(workfile,"typesearch=%u\n",complete_search);
-              fprintf(workfile,"start_a0=%u\n",a0);
-              fprintf(workfile,"nexttype=0\n");
-              fprintf(workfile,"end_a0=%u\n",end_a0);
-              fprintf(workfile,"start_b0=%u\n",b0);
-              fclose(workfile);              
+           if(save_request||stop_request)  {
+              save_request=0;
+              save_work(R_parameter,a0,0,end_a0,b0);
+              if(stop_request)  {
+                 printf("Stopped by a signal, the work is saved at a0=%u,type=0,b0=%u\n",a0,b0);
+                 exit(0);
+              }
             }
-                u=((powmod4(a0,65536)+65536-powmod4(b0,65536))&65535)>>12;
-                if(u<=2)  {
-                   for(h=1;h<5;h++)  {
-                       for(g=h;g<625;g+=5)  {
-                           u=g+625-(a0%625);
-                           a1=a0+(((u*inv_16384_625)%625)<<14);
-                           T=rem625[g];
-                           for(f=T;f<T+4;f++)  {
-                               u=Inverserem625[f]+625-(b0%625);
-                               b1=b0+(((u*inv_16384_625)%625)<<14);
-                               limit=(a1+step-b1)%step;
-                               if(limit==0)  limit=step;
-                               for(diff=limit;diff<Range;diff+=step)  {
-                               //for(a=a1;a<Range;a+=step)  {
-                               //    for(b=b1;b<a;b+=step)  {
-                               // a-b=diff, note that diff>0
-                                       k=diff;
-                                       expo=0;
-                                       while(k%3==0)  k/=3,expo++;
-                                       if((expo&3)==0)  {
-                                       while(k%5==0)  k/=5,expo++;
-                                       if((expo&3)==0)  {  // not need to set expo=0, because we know that expo%4=0
-                                       while((k&1)==0)  k>>=1;
-                                       if((k&7)==1)  {
-                                       rem120=((k/120)<<3)+convert120[k%120];
-                                       if(Bits[rem120&31]&Table[rem120>>5])  {
-                                       for(b=b1;b+diff<Range;b+=step)  {
-                                       a=b+diff;
-                                       m=a+b;
-                                       expo=0;
-                                       while(m%3==0)  m/=3,expo++;
-                                       if((expo&3)==0)  {
-                                       while(m%5==0)  m/=5,expo++;
-                                       if((expo&3)==0)  {
-                                       while((m&1)==0)  m>>=1;
-                                       if((m&7)==1)  {
-                                       rem120=((m/120)<<3)+convert120[m%120];
-                                       if((Bits[rem120&31]&Table[rem120>>5])&&A[(3125+rem3125[a%3125]-rem3125[b%3125])/625])
-                                           check(a,b,1);
-                                       }}}}}}}
-                                   }
-                               }
-                           }
-                       }
-                   }
-                }
+            work_a0=a0,work_type=0,work_b0=b0;
+            search_b0(a0,b0,0);
             if((b0&1023)<512)  b0+=1024-2*(b0&1023);
             else               b0+=2048-2*(b0&1023);
             }
@@ -1311,96 +1944,32 @@ int main ()  {
   out=fopen("stat_euler(4,3,1).txt","a+");
   fprintf(out,"Finished: a0=%u,Range=%u,type=0,Time: %uh%um%us,Date: %s",a0,Range,allsec/3600,(allsec%3600)/60,allsec%60,ctime(&date));
   fclose(out);
-        remove("euler413work.txt");
-        workfile=fopen("euler413work.txt","a+");
-        fprintf(workfile,"// Please don't modify this file\n");
-        fprintf(workfile,"R_parameter=%u\n",R_parameter);
-        fprintf(workfile,"typesearch=%u\n",complete_search);
-        fprintf(workfile,"start_a0=%u\n",a0+8-8*complete_search);
-        fprintf(workfile,"nexttype=%u\n",complete_search);
-        fprintf(workfile,"end_a0=%u\n",end_a0);
-        fprintf(workfile,"start_b0=%u\n",start_b0);
-        fclose(workfile);
+        save_work(R_parameter,a0+8-8*complete_search,complete_search,end_a0,start_b0);
         printf("Finished: a0=%u,Range=%u,type=0,Time: %uh%um%us,Date: %s",a0,Range,allsec/3600,(allsec%3600)/60,allsec%60,ctime(&date));
        }
 
         if(complete_search)  {
 
            for(b0=start_b0;b0<16384;b0+=8)  {
-           if(time(NULL)-previous_update>TIME_INTERVAL)  {
-              previous_update=time(NULL);
-              remove("euler413work.txt");
-              workfile=fopen("euler413work.txt","a+");
-              fprintf(workfile,"// Please don't modify this file\n");
-              fprintf(workfile,"R_parameter=%u\n",R_parameter);
-              fprintf(workfile,"typesearch=%u\n",complete_search);
-              fprintf(workfile,"start_a0=%u\n",a0);
-              fprintf(workfile,"nexttype=1\n");
-              fprintf(workfile,"end_a0=%u\n",end_a0);
-              fprintf(workfile,"start_b0=%u\n",b0);
-              fclose(workfile);
+           if(save_request||stop_request)  {
+              save_request=0;
+              save_work(R_parameter,a0,1,end_a0,b0);
+              if(stop_request)  {
+                 printf("Stopped by a signal, the work is saved at a0=%u,type=1,b0=%u\n",a0,b0);
+                 exit(0);
+              }
             }
-               for(h=1;h<5;h++)  {
-                   for(g=h;g<625;g+=5)  {
-                       u=g+625-(a0%625);
-                       a1=a0+(((u*inv_16384_625)%625)<<14);
-                       T=rem625[g];
-                       for(f=T;f<T+4;f++)  {
-                           u=Inverserem625[f]+625-(b0%625);
-                           b1=b0+(((u*inv_16384_625)%625)<<14);
-                               limit=(a1+step-b1)%step;
-                               if(limit==0)  limit=step;
-                               for(diff=limit;diff<Range;diff+=step)  {
-                           //for(a=a1;a<Range;a+=step)  {
-                           //    for(b=b1;b<a;b+=step)  {
-                           //            k=a-b;
-                                       k=diff;
-                                       expo=0;
-                                       while(k%3==0)  k/=3,expo++;
-                                       if((expo&3)==0)  {
-                                       while(k%5==0)  k/=5,expo++;
-                                       if((expo&3)==0)  {
-                                       while((k&1)==0)  k>>=1;
-                                       if((k&7)==1)  {
-                                       rem120=((k/120)<<3)+convert120[k%120];
-                                       if(Bits[rem120&31]&Table[rem120>>5])  {
-                                       for(b=b1;b+diff<Range;b+=step)  {
-                                       a=b+diff;
-                                       m=a+b;
-                                       expo=0;
-                                       while(m%3==0)  m/=3,expo++;
-                                       if((expo&3)==0)  {
-                                       while(m%5==0)  m/=5,expo++;
-                                       if((expo&3)==0)  {
-                                       while((m&1)==0)  m>>=1;
-                                       if((m&7)==1)  {
-                                       rem120=((m/120)<<3)+convert120[m%120];
-                                       if((Bits[rem120&31]&Table[rem120>>5])&&A[(3125+rem3125[a%3125]-rem3125[b%3125])/625])
-                                           check(a,b,2);
-                                       }}}}}}}
-                               }
-                           }
-                       }
-                   }
-               }
+            work_a0=a0,work_type=1,work_b0=b0;
+               search_b0(a0,b0,1);
            }
         time(&date);
         allsec=time(NULL)-seconds;
         out=fopen("stat_euler(4,3,1).txt","a+");
         fprintf(out,"Finished: a0=%u,Range=%u,type=1,Time: %uh%um%us,Date: %s",a0,Range,allsec/3600,(allsec%3600)/60,allsec%60,ctime(&date));
         fclose(out);
-        remove("euler413work.txt");
-        workfile=fopen("euler413work.txt","a+");
-        fprintf(workfile,"// Please don't modify this file\n");
-        fprintf(workfile,"R_parameter=%u\n",R_parameter);
-        fprintf(workfile,"typesearch=%u\n",complete_search);
-        fprintf(workfile,"start_a0=%u\n",a0+8);
-        fprintf(workfile,"nexttype=0\n");
-        fprintf(workfile,"end_a0=%u\n",end_a0);
         start_b0=(a0+8)&1023;
         if(start_b0>512)  start_b0=1024-start_b0;
-        fprintf(workfile,"start_b0=%u\n",start_b0);
-        fclose(workfile);
+        save_work(R_parameter,a0+8,0,end_a0,start_b0);
 
         printf("Finished: a0=%u,Range=%u,type=1,Time: %uh%um%us,Date: %s",a0,Range,allsec/3600,(allsec%3600)/60,allsec%60,ctime(&date));
         }
@@ -1412,26 +1981,8 @@ int main ()  {
   allsec=time(NULL)-seconds;
   printf("Time: %uh%um%us,Date: %s",allsec/3600,(allsec%3600)/60,allsec%60,ctime(&date));
 
-  free(isprime);
-  free(Table);
-  free(L);
-  free(R);
-  free(temp);
-  free(count17);
-  free(count29);
-  free(count481);
-  free(specialcount29);
-  free(specialcount481);
-  for(i=0;i<289;i++)  free(multipliers17[i]);
-  free(multipliers17);
-  for(i=0;i<841;i++)  free(multipliers29[i]);
-  free(multipliers29);
-  for(i=0;i<231361;i++) free(multipliers481[i]);
-  free(multipliers481);
-  for(i=0;i<841;i++)  free(specialmultipliers29[i]);
-  free(specialmultipliers29);
-  for(i=0;i<231361;i++) free(specialmultipliers481[i]);
-  free(specialmultipliers481);
+  free_tables();
 
   return 0;
 }
+#endif
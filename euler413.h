@@ -0,0 +1,37 @@
+// Library interface of euler413.c: compile euler413.c with -DEULER413_LIBRARY to leave out main() and the other parts
+// of the program ( the workfile, the timer and the worker ) and call these functions from your own driver.
+// Only these functions are external, so it can be linked with euler.c into one driver, see library_test.c.
+// The tables are static in euler413.c, so there can be only one context at a time in a process,
+// but the tables are kept between the calls: a driver can search any number of units after one euler413_init().
+
+#ifndef EULER413_H
+#define EULER413_H
+
+typedef struct  {
+   unsigned int R_parameter;  // search a<R_parameter*10240000, it should be 0<R<195
+   unsigned int start_R_parameter;  // and start_R_parameter*10240000<=a, it should be 0<=R0<R
+   unsigned int complete_search;  // 0 for the special search, 1 for the full search
+   // called for each solution a^4=b^4+c^4+d^4, primitive is 1 if gcd(a,b,c,d)=1.
+   // If it is NULL then the solution is printed and appended to results_euler(4,1,3).txt
+   void (*solution)(void* user, unsigned int a, unsigned int b, unsigned int c, unsigned int d, int primitive);
+   // called after each unit of euler413_search_a0(), it can be NULL
+   void (*progress)(void* user, unsigned int a0, unsigned int type, unsigned int b0);
+   void* user;  // passed to the callbacks
+} euler413_context;
+
+// builds the tables for the parameters of ctx, or only extends them if they are already built
+// for a smaller R_parameter. Returns 0 on success and 1 for bad parameters.
+int euler413_init(euler413_context* ctx);
+
+// searches one (a0,type,b0) unit, a0==1 mod 8, a0<16384, b0<16384,
+// for type=0 b0==+-a0 mod 1024, for type=1 b0==0 mod 8 and it needs complete_search=1.
+// Returns 0 on success and 1 for a bad unit.
+int euler413_search_unit(euler413_context* ctx, unsigned int a0, unsigned int type, unsigned int b0);
+
+// searches all units of a0, the same as one a0 value of the program
+int euler413_search_a0(euler413_context* ctx, unsigned int a0);
+
+// frees the tables, after this euler413_init() builds them again
+void euler413_free(euler413_context* ctx);
+
+#endif
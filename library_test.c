@@ -0,0 +1,82 @@
+// Test of the library interfaces of euler.c and euler413.c linked into one driver, compile with
+// gcc -O2 -o library_test library_test.c euler.c euler413.c -DEULER_LIBRARY -DEULER413_LIBRARY -lm -lpthread
+// Only the functions of euler.h and euler413.h are external, so the link fails if an other symbol of the two
+// programs is external. The smallest known solutions are found again with small Ranges, the exit code is 1 if one is missed.
+//
+
+#include <stdio.h>
+#include <stdlib.h>
+#include "euler.h"
+#include "euler413.h"
+
+   unsigned long int found6=0,found4=0;
+
+unsigned long int powmod6(unsigned long int a, unsigned long int p)
+{
+   unsigned long int j,x=1;
+
+   for(j=0;j<6;j++)  x=x*a%p;
+
+   return x;
+}
+
+void solution6(void* user, unsigned long int a, unsigned long int b, unsigned long int c,
+               unsigned long int d, unsigned long int e, unsigned long int f, unsigned long int g)
+{
+// 1117^6+770^6=1092^6+861^6+602^6+212^6+84^6, the order of the terms on a side doesn't matter
+   unsigned long int m,n,t,x[7];
+   static const unsigned long int known[7]={1117,770,1092,861,602,212,84};
+
+   x[0]=a,x[1]=b,x[2]=c,x[3]=d,x[4]=e,x[5]=f,x[6]=g;
+   for(m=0;m<7;m++)
+       for(n=m+1;n<((m<2)?2:7);n++)
+           if(x[n]>x[m])  t=x[m],x[m]=x[n],x[n]=t;
+   for(m=0;(m<7)&&(x[m]==known[m]);m++);
+   // it is found in each residue of a choice of e,f,g, so it is printed only at the first time
+   if(m==7)  found6++;
+   if((m<7)||(found6==1))  printf("euler: %ld^6+%ld^6=%ld^6+%ld^6+%ld^6+%ld^6+%ld^6\n",a,b,c,d,e,f,g);
+
+   return;
+}
+
+void solution4(void* user, unsigned int a, unsigned int b, unsigned int c, unsigned int d, int primitive)
+{
+   printf("euler413: %u^4=%u^4+%u^4+%u^4%s\n",a,b,c,d,primitive?"  (primitive)":"");
+   if((a==422481)&&primitive)  found4++;
+
+   return;
+}
+
+int main (int argc, char *argv[])  {
+
+   euler_context ctx6={0};
+   euler413_context ctx4={0};
+   unsigned long int c,i,m,n;
+   static const unsigned long int right[5]={1092,861,602,212,84};
+
+   // the residues (e^6+f^6+g^6)%p of the choices of e,f,g divisible by 7 from the right side, as in euler -bench
+   ctx6.solution=solution6;
+   ctx6.Range=1200;
+   if(euler_init(&ctx6))  return 1;
+   for(c=0;c<5;c++)
+       for(m=c+1;m<5;m++)
+           for(n=m+1;n<5;n++)  {
+               if((right[c]%7)||(right[m]%7)||(right[n]%7))  continue;
+               i=(powmod6(right[c],ctx6.p)+powmod6(right[m],ctx6.p)+powmod6(right[n],ctx6.p))%ctx6.p;
+               euler_search_residue(&ctx6,i,0);
+           }
+   euler_free(&ctx6);
+
+   // 422481=12881 mod 16384 is in the a0=12881 class of the special search
+   ctx4.R_parameter=1;
+   ctx4.start_R_parameter=0;
+   ctx4.complete_search=0;
+   ctx4.solution=solution4;
+   if(euler413_init(&ctx4))  return 1;
+   euler413_search_a0(&ctx4,12881);
+   euler413_free(&ctx4);
+
+   printf("euler: %s, euler413: %s\n",found6?"found":"MISSED",found4?"found":"MISSED");
+
+   return (found6==0)||(found4==0);
+}